@@ -20,6 +20,7 @@
  */
 #include "defs.h"
 #include "filterdefs.h"
+#include "gbnum.h"
 #include "grtcirc.h"
 
 #if FILTERS_ENABLED
@@ -60,12 +61,13 @@ arcdist_process(void)
         double lat1, lon1, lat2, lon2;
 	int fileline = 0;
 	char *line;
+	const char *p;
 	gbfile *file_in;
 
 	file_in = gbfopen(arcfileopt, "r", MYNAME);
 	
         lat1 = lon1 = lat2 = lon2 = BADVAL;
-	while ((line = gbfgetstr(file_in))) {
+	while ((line = gbfgetline(file_in))) {
 	    char *pound = NULL;
 	    int argsfound = 0;
 	    
@@ -80,7 +82,8 @@ arcdist_process(void)
 	    }
 	    
 	    lat2 = lon2 = BADVAL;
-	    argsfound = sscanf( line, "%lf %lf", &lat2, &lon2 );
+	    p = line;
+	    argsfound = gb_scan_dbl(&p, &lat2) ? 1 + gb_scan_dbl(&p, &lon2) : 0;
 	   
 	    if ( argsfound != 2 && strspn(line, " \t\n") < strlen(line)) {
                 warning(MYNAME ": Warning: Arc file contains unusable vertex on line %d.\n", fileline );
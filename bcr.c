@@ -291,7 +291,7 @@ bcr_data_read(void)
 				c = strchr(str, ',');
 				if (c != NULL) *c = '\0';
 				if (*str) {
-					xfree(wpt->shortname);
+					strpool_release(wpt->shortname);
 					wpt->shortname = xstrdup(str);
 				}
 			}
@@ -262,6 +262,133 @@ cet_utf8_to_char(const char *str, const cet_cs_vec_t *vec, /* out */ int *bytes,
 	return cet_ucs4_to_char(v, vec);
 }
 
+/* =========================================================================== */
+/* %%%                         lookup tables                               %%% */
+/* =========================================================================== */
+
+/*
+ * Converting whole strings character by character through the functions
+ * above costs two binary searches and possibly a recursion into the
+ * fallback set for every character.  The first string conversion with a
+ * character set builds direct tables instead: the UTF-8 sequence of each
+ * of the 256 characters, and a two-level UCS-4 to character table whose
+ * pages of 256 values are filled as they are first needed.
+ */
+
+typedef struct cet_tables_s
+{
+	char utf8[256][8];		/* UTF-8 sequence of each character	*/
+	unsigned char utf8_len[256];	/* ... and its length			*/
+	short *page[256];		/* UCS-4 to char, for values < 0x10000	*/
+	int ascii;			/* 7-bit characters are unchanged	*/
+} cet_tables_t;
+
+static short *
+cet_tables_page(cet_tables_t *t, const cet_cs_vec_t *vec, int value)
+{
+	short *page = t->page[value >> 8];
+	
+	if (page == NULL)
+	{
+	    int i, base = value & ~0xff;
+	    page = t->page[value >> 8] = xmalloc(256 * sizeof(*page));
+	    for (i = 0; i < 256; i++)
+		page[i] = cet_ucs4_to_char(base + i, vec);
+	}
+	return page;
+}
+
+static cet_tables_t *
+cet_tables(const cet_cs_vec_t *vec)
+{
+	cet_tables_t *t = (cet_tables_t *)vec->tables;
+	char temp = CET_NOT_CONVERTABLE_DEFAULT;
+	short *page;
+	int c;
+
+	if (t != NULL) return t;
+
+	t = xcalloc(1, sizeof(*t));
+	for (c = 1; c < 256; c++)
+	{
+	    int value;
+	    if (CET_ERROR == cet_char_to_ucs4(c, vec, &value))
+		cet_char_to_ucs4(temp, vec, &value);
+	    t->utf8_len[c] = cet_ucs4_to_utf8(t->utf8[c], sizeof(t->utf8[c]), value);
+	}
+	
+	page = cet_tables_page(t, vec, 0);
+	t->ascii = 1;
+	for (c = 1; c < 0x80; c++)
+	{
+	    if ((t->utf8_len[c] != 1) || (t->utf8[c][0] != c) || (page[c] != c))
+		t->ascii = 0;
+	}
+	
+	((cet_cs_vec_t *)vec)->tables = t;
+	return t;
+}
+
+static short
+cet_tables_ucs4_to_char(cet_tables_t *t, const cet_cs_vec_t *vec, int value)
+{
+	if ((value & 0xffff0000) == 0)
+	    return cet_tables_page(t, vec, value)[value & 0xff];
+	else
+	    return cet_ucs4_to_char(value, vec);
+}
+
+void
+cet_free_tables(cet_cs_vec_t *vec)
+{
+	cet_tables_t *t = (cet_tables_t *)vec->tables;
+	int i;
+	
+	if (t == NULL) return;
+	
+	for (i = 0; i < 256; i++)
+	    if (t->page[i]) xfree(t->page[i]);
+	xfree(t);
+	vec->tables = NULL;
+}
+
+/* %%% cet_str_is_ascii %%%
+ *
+ * Returns 1 if the string has only 7-bit characters.
+ * Tests eight characters at a time.
+ */
+int
+cet_str_is_ascii(const char *str)
+{
+	size_t len = strlen(str);
+	const char *cend = str + len;
+	gbuint32 acc = 0;
+	
+	while (cend - str >= 8)
+	{
+	    gbuint32 w[2];
+	    memcpy(w, str, 8);
+	    acc |= w[0] | w[1];
+	    str += 8;
+	}
+	while (str < cend)
+	    acc |= (unsigned char)*str++;
+	
+	return (acc & 0x80808080) == 0;
+}
+
+/* %%% cet_str_unchanged %%%
+ *
+ * Returns 1 if converting src from or to the given character set
+ * would give an identical string.
+ */
+int
+cet_str_unchanged(const char *src, const cet_cs_vec_t *vec)
+{
+	if (vec->ucs4_count == 0) return 1;		/* UTF-8 -> UTF-8 */
+	return cet_tables(vec)->ascii && cet_str_is_ascii(src);
+}
+
 /* =========================================================================== */
 /* %%%              UTF-8 string manipulation functions                    %%% */
 /* =========================================================================== */
@@ -352,9 +479,16 @@ cet_str_utf8_to_any(const char *src, const cet_cs_vec_t *vec)
 	int len;
 	char *res, *dest, *cend;
 
+	cet_tables_t *t;
+	short *ascii;
+
 	if (c == NULL) return NULL;
 	if (vec->ucs4_count == 0) return xstrdup(src); /* UTF-8 -> UTF-8 */
 	
+	t = cet_tables(vec);
+	if (t->ascii && cet_str_is_ascii(src)) return xstrdup(src);
+	ascii = t->page[0];
+	
 	len = strlen(c);
 	res = dest = xmalloc(len + 1);	/* target will become smaller or equal length */
 	
@@ -362,8 +496,15 @@ cet_str_utf8_to_any(const char *src, const cet_cs_vec_t *vec)
 
 	while (c < cend)
 	{
-	    int bytes;
-	    *dest++ = cet_utf8_to_char(c, vec, &bytes, NULL);
+	    int bytes, value;
+	    
+	    if ((*c & 0x80) == 0)
+	    {
+		*dest++ = ascii[(unsigned char)*c++];
+		continue;
+	    }
+	    cet_utf8_to_ucs4(c, &bytes, &value);
+	    *dest++ = cet_tables_ucs4_to_char(t, vec, value);
 	    c += bytes;
 	}
 	*dest = '\0';
@@ -379,35 +520,73 @@ cet_str_utf8_to_any(const char *src, const cet_cs_vec_t *vec)
 char *
 cet_str_any_to_utf8(const char *src, const cet_cs_vec_t *vec)
 {
-	int len, value;
-	char *result, *cin, *cout;
-	char temp = CET_NOT_CONVERTABLE_DEFAULT;
+	int len;
+	char *result, *cout;
+	const unsigned char *cin;
+	cet_tables_t *t;
 
-	cin = (char *)src;
-	if (cin == NULL) return NULL;
+	if (src == NULL) return NULL;
 	if (vec->ucs4_count == 0) return xstrdup(src); /* UTF-8 -> UTF-8 */
 
+	t = cet_tables(vec);
+	if (t->ascii && cet_str_is_ascii(src)) return xstrdup(src);
+
 	len = 0;
-	while (*cin != '\0')		/* determine length of resulting UTF-8 string */
-	{
-	    if (CET_ERROR == cet_char_to_ucs4(*cin++, vec, &value))
-		cet_char_to_ucs4(temp, vec, &value);
-	    len += cet_ucs4_to_utf8(NULL, 6, value);
-	}
+	for (cin = (const unsigned char *)src; *cin != '\0'; cin++)	/* determine length of resulting UTF-8 string */
+	    len += t->utf8_len[*cin];
 
 	result = cout = xmalloc(len + 1);
-	cin = (char *)src;
 
-	while (*cin != '\0')		
+	for (cin = (const unsigned char *)src; *cin != '\0'; cin++)
 	{
-	    if (CET_ERROR == cet_char_to_ucs4(*cin++, vec, &value))
-		cet_char_to_ucs4(temp, vec, &value);
-	    cout += cet_ucs4_to_utf8(cout, 6, value);
+	    memcpy(cout, t->utf8[*cin], t->utf8_len[*cin]);
+	    cout += t->utf8_len[*cin];
 	}
 	*cout = '\0';			
 	return result;
 }
 
+/* %%% cet_ucs2_to_utf8 %%%
+ *
+ * Converts count UCS-2 characters (little or big endian) to UTF-8.
+ * dest needs room for 3 * count bytes; returns the length of the result.
+ * Runs of ASCII are taken four characters (one 64 bit word) at a time.
+ */
+int
+cet_ucs2_to_utf8(char *dest, const void *src, const int count, const int big_endian)
+{
+	/* high bytes zero and low bytes below 0x80, in memory order */
+	static const unsigned char ascii_le[8] = { 0x80, 0xff, 0x80, 0xff, 0x80, 0xff, 0x80, 0xff };
+	static const unsigned char ascii_be[8] = { 0xff, 0x80, 0xff, 0x80, 0xff, 0x80, 0xff, 0x80 };
+	const unsigned char *cin = src;
+	const unsigned char *cend = cin + 2 * count;
+	unsigned char *cout = (unsigned char *) dest;
+	unsigned long long mask;
+	int lo = big_endian ? 1 : 0;
+
+	memcpy(&mask, big_endian ? ascii_be : ascii_le, sizeof(mask));
+
+	while (cin < cend) {
+		unsigned long long w;
+
+		if (cend - cin >= 8) {
+			memcpy(&w, cin, sizeof(w));
+			if ((w & mask) == 0) {
+				cout[0] = cin[lo];
+				cout[1] = cin[lo + 2];
+				cout[2] = cin[lo + 4];
+				cout[3] = cin[lo + 6];
+				cin += 8;
+				cout += 4;
+				continue;
+			}
+		}
+		cout += cet_ucs4_to_utf8((char *) cout, 3, cin[lo] | (cin[lo ^ 1] << 8));
+		cin += 2;
+	}
+	return cout - (unsigned char *) dest;
+}
+
 /* %%% cet_str_uni_to_utf8 %%%
  *
  * Converts an unicode string to UTF-8
@@ -415,27 +594,14 @@ cet_str_any_to_utf8(const char *src, const cet_cs_vec_t *vec)
 char *
 cet_str_uni_to_utf8(const short *src, const int length)
 {
-	int i, len;
-	unsigned short *cin;
-	char *res, *cout;
+	int len;
+	char *res;
 	
 	if (src == NULL) return NULL;
 	
-	len = 0;
-	i = length;
-	cin = (unsigned short *)src;
-
-	while (i-- > 0)
-	    len += cet_ucs4_to_utf8(NULL, 6, le_read16(cin++));
-	
-	res = cout = xmalloc(len + 1);
-	cin = (unsigned short *)src;
-	i = length;
-
-	while (i-- > 0)
-	    cout += cet_ucs4_to_utf8(cout, 6, le_read16(cin++));
-	    
-	*cout = '\0';
+	res = xmalloc(3 * length + 1);
+	len = cet_ucs2_to_utf8(res, src, length, 0);
+	res[len] = '\0';
 
 	return res;
 }
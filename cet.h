@@ -48,6 +48,7 @@ typedef struct cet_cs_vec_s
 	const cet_ucs4_link_t *ucs4_extra;	/* Non standard UCS-4 to ...    */
 	const int ucs4_extras;			/* number of extra links 	*/
 	struct cet_cs_vec_s *next;
+	void *tables;				/* lookup tables, see cet.c	*/
 } cet_cs_vec_t;
 
 /* single char/value transmission */
@@ -66,8 +67,13 @@ short cet_ucs4_to_char(const int value, const cet_cs_vec_t *vec);
 char *cet_str_utf8_to_any(const char *src, const cet_cs_vec_t *vec);
 char *cet_str_any_to_utf8(const char *src, const cet_cs_vec_t *vec);
 
+int cet_ucs2_to_utf8(char *dest, const void *src, const int count, const int big_endian);
 char *cet_str_uni_to_utf8(const short *src, const int length);
 
+int cet_str_is_ascii(const char *str);
+int cet_str_unchanged(const char *src, const cet_cs_vec_t *vec);
+void cet_free_tables(cet_cs_vec_t *vec);
+
 /* UTF-8 string manipulation functions */
 
 unsigned int cet_utf8_strlen(const char *str);
@@ -40,7 +40,7 @@ static cet_cs_vec_t *cet_cs_vec_root = NULL;
 
 typedef struct cet_cs_alias_s
 {
-	char *name;
+	const char *name;
 	cet_cs_vec_t *vec;
 } cet_cs_alias_t;
 
@@ -800,12 +800,12 @@ cet_register_cs(&cet_cs_vec_vps);
 		{
 		    char **a = (char **)p->alias;
 		    
-		    list[i].name = xstrdup(p->name);
+		    list[i].name = p->name;
 		    list[i].vec = p;
 		    i++;
 		    while (*a != NULL)
 		    {
-			list[i].name = xstrdup(*a);
+			list[i].name = *a;
 			list[i].vec = p;
 			i++;
 			a++;
@@ -839,10 +839,36 @@ cet_register_cs(&cet_cs_vec_vps);
 #endif
 }
 
+/*
+ * Nearly all modules read and write UTF-8 or US-ASCII.  These two are
+ * found without registering the other character sets, so that a run
+ * which never needs anything else does not pay for the registry.
+ */
+
+static cet_cs_vec_t *
+cet_find_builtin_cs(const char *name)
+{
+	cet_cs_vec_t *builtin[] = { &cet_cs_vec_utf8, &cet_cs_vec_ansi_x3_4_1968 };
+	unsigned int i;
+	
+	for (i = 0; i < sizeof(builtin) / sizeof(builtin[0]); i++)
+	{
+	    const char **a;
+	    
+	    if (case_ignore_strcmp(name, builtin[i]->name) == 0) return builtin[i];
+	    for (a = builtin[i]->alias; *a != NULL; a++)
+		if (case_ignore_strcmp(name, *a) == 0) return builtin[i];
+	}
+	return NULL;
+}
+
 cet_cs_vec_t *
 cet_find_cs_by_name(const char *name)
 {
 	int i, j;
+	cet_cs_vec_t *vec;
+	
+	if ((vec = cet_find_builtin_cs(name))) return vec;
 	
 	cet_register();
 	
@@ -869,17 +895,19 @@ cet_find_cs_by_name(const char *name)
 void 
 cet_deregister(void)
 {
-	int i;
-	int j = cet_cs_alias_ct;
 	cet_cs_alias_t *p = cet_cs_alias;
+	cet_cs_vec_t *vec;
 	
+	cet_free_tables(&cet_cs_vec_utf8);
+	cet_free_tables(&cet_cs_vec_ansi_x3_4_1968);
+	for (vec = cet_cs_vec_root; vec != NULL; vec = vec->next)
+	    cet_free_tables(vec);
+
 	if (p == NULL) return;
 
 	cet_cs_alias_ct = 0;
 	cet_cs_alias = NULL;
 	
-	for (i = 0; i < j; i++)
-	    xfree(p[i].name);
 	xfree(p);
 }
 
@@ -973,6 +1001,90 @@ cet_convert_from_utf8(const char *str)
 	return cet_str_utf8_to_any(str, global_opts.charset);
 }
 
+/*
+ * Output conversion keeps the original strings in a journal, keyed by
+ * the location of the field they were taken from, instead of backing up
+ * the whole data set.  cet_restore_strings() walks the data again and
+ * puts every original back into its field, whatever the writer has left
+ * there in the meantime.
+ */
+
+typedef struct {
+	char **field;
+	char *original;
+} cet_journal_t;
+
+static cet_journal_t *cet_journal;
+static unsigned int cet_journal_size;		/* a power of two, or 0 */
+static unsigned int cet_journal_ct;
+static int cet_restoring;
+
+static unsigned int
+cet_journal_hash(char **field)
+{
+	unsigned long a = (unsigned long) field;
+	return (unsigned int) ((a >> 3) ^ (a >> 17));
+}
+
+static void
+cet_journal_add(char **field, char *original)
+{
+	unsigned int i;
+
+	if (2 * (cet_journal_ct + 1) > cet_journal_size) {
+		cet_journal_t *old = cet_journal;
+		unsigned int old_size = cet_journal_size;
+
+		cet_journal_size = old_size ? 2 * old_size : 1024;
+		cet_journal = xcalloc(cet_journal_size, sizeof(*cet_journal));
+		cet_journal_ct = 0;
+		for (i = 0; i < old_size; i++) {
+			if (old[i].field) {
+				cet_journal_add(old[i].field, old[i].original);
+			}
+		}
+		if (old) xfree(old);
+	}
+	i = cet_journal_hash(field) & (cet_journal_size - 1);
+	while (cet_journal[i].field) {
+		i = (i + 1) & (cet_journal_size - 1);
+	}
+	cet_journal[i].field = field;
+	cet_journal[i].original = original;
+	cet_journal_ct++;
+}
+
+/* Take the original string of a converted field out of the journal. */
+
+static char *
+cet_journal_take(char **field)
+{
+	unsigned int i, j;
+	char *original;
+
+	if (cet_journal_ct == 0) return NULL;
+
+	i = cet_journal_hash(field) & (cet_journal_size - 1);
+	while (cet_journal[i].field != field) {
+		if (cet_journal[i].field == NULL) return NULL;
+		i = (i + 1) & (cet_journal_size - 1);
+	}
+	original = cet_journal[i].original;
+	cet_journal_ct--;
+
+	/* Close the gap so that the probe sequences of later entries hold. */
+	for (j = (i + 1) & (cet_journal_size - 1); cet_journal[j].field; j = (j + 1) & (cet_journal_size - 1)) {
+		unsigned int k = cet_journal_hash(cet_journal[j].field) & (cet_journal_size - 1);
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+			cet_journal[i] = cet_journal[j];
+			i = j;
+		}
+	}
+	cet_journal[i].field = NULL;
+	cet_journal[i].original = NULL;
+	return original;
+}
+
 /* cet_convert_string: internal used within cet_convert_strings process */
 
 char *
@@ -982,12 +1094,48 @@ cet_convert_string(char *str)
 	
 	if (str == NULL) return NULL;		/* return origin if empty or NULL */
 	else if (*str == '\0') return str;
+
+	if (cet_str_unchanged(str, global_opts.charset)) return str;
 	
 	res = converter(str);
-	xfree(str);
+	strpool_release(str);
 	return res;
 }
 
+/* cet_convert_field: as cet_convert_string, for a string field of the
+ * data; conversions for output are journaled so that they can be undone */
+
+void
+cet_convert_field(char **field)
+{
+	char *str = *field;
+	char *res;
+
+	if (cet_restoring) {
+		if ((res = cet_journal_take(field))) {
+			strpool_release(*field);
+			*field = res;
+		}
+		return;
+	}
+
+	if (cet_output == 0) {
+		*field = cet_convert_string(str);
+		return;
+	}
+
+	if ((str == NULL) || (*str == '\0')) return;
+	if (cet_str_unchanged(str, global_opts.charset)) return;
+
+	res = converter(str);
+	if (strcmp(res, str) == 0) {
+		xfree(res);
+		return;
+	}
+	cet_journal_add(field, str);
+	*field = res;
+}
+
 /* cet_convert_waypt: internal used within cet_convert_strings process */
 
 static void
@@ -1002,17 +1150,17 @@ cet_convert_waypt(const waypoint *wpt)
 	
 	w->wpt_flags.cet_converted = 1;
 	
-	w->shortname = cet_convert_string(wpt->shortname);
-	w->description = cet_convert_string(wpt->description);
-	w->notes = cet_convert_string(wpt->notes);
-	w->url = cet_convert_string(wpt->url);
-	w->url_link_text = cet_convert_string(wpt->url_link_text);
+	cet_convert_field(&w->shortname);
+	cet_convert_field(&w->description);
+	cet_convert_field(&w->notes);
+	cet_convert_field(&w->url);
+	cet_convert_field(&w->url_link_text);
 	for (url_next = w->url_next; url_next; url_next = url_next->url_next) {
-		url_next->url = cet_convert_string(url_next->url);
-		url_next->url_link_text = cet_convert_string(url_next->url_link_text);
+		cet_convert_field(&url_next->url);
+		cet_convert_field(&url_next->url_link_text);
 	}
-	gc_data->placer = cet_convert_string(gc_data->placer);
-	gc_data->hint = cet_convert_string(gc_data->hint);
+	cet_convert_field(&gc_data->placer);
+	cet_convert_field(&gc_data->hint);
 	
 	fs = wpt->fs;
 	while (fs != NULL)
@@ -1034,9 +1182,9 @@ cet_convert_route_hdr(const route_head *route)
 	
 	rte->cet_converted = 1;
 	
-	rte->rte_name = cet_convert_string(route->rte_name);
-	rte->rte_desc = cet_convert_string(route->rte_desc);
-	rte->rte_url = cet_convert_string(route->rte_url);
+	cet_convert_field(&rte->rte_name);
+	cet_convert_field(&rte->rte_desc);
+	cet_convert_field(&rte->rte_url);
 }
 
 /* cet_convert_route_tlr: internal used within cet_convert_strings process */
@@ -1096,6 +1244,37 @@ cet_convert_strings(const cet_cs_vec_t *source, const cet_cs_vec_t *target, cons
 		printf(", done.\n");
 }
 
+/* %%% cet_restore_strings (public) %%%
+ *
+ * - Undo the last conversion from UTF-8 made by cet_convert_strings - */
+
+void
+cet_restore_strings(void)
+{
+	unsigned int i;
+
+	if (cet_journal == NULL) return;
+
+	cet_output = 1;
+	cet_restoring = 1;
+	waypt_disp_all(cet_convert_waypt);
+	route_disp_all(cet_convert_route_hdr, cet_convert_route_tlr, cet_convert_waypt);
+	track_disp_all(cet_convert_route_hdr, cet_convert_route_tlr, cet_convert_waypt);
+	cet_restoring = 0;
+	cet_output = 0;
+
+	/* Whatever is left was replaced by the writer; drop the originals. */
+	for (i = 0; cet_journal_ct && i < cet_journal_size; i++) {
+		if (cet_journal[i].field) {
+			strpool_release(cet_journal[i].original);
+			cet_journal_ct--;
+		}
+	}
+	xfree(cet_journal);
+	cet_journal = NULL;
+	cet_journal_size = 0;
+}
+
 /* %%% cet_disp_character_set_names %%%
  *
  * - Put all character set names and aliases to "FILE" - */
@@ -1107,6 +1286,7 @@ cet_disp_character_set_names(FILE *fout)
 	cet_cs_vec_t *vec;
 	cet_cs_vec_t **list;
 	    
+	cet_register();
 	if (cet_cs_alias_ct == 0) return;
 	
 	c = 0;
@@ -107,11 +107,13 @@ int cet_gbfprintf(gbfile *stream, const cet_cs_vec_t *src_vec, const char *fmt,
 
 /* cet_convert_string: !!! ONLY VALID WITHIN 'cet_convert_strings' process !!! */
 char *cet_convert_string(char *str);
+void cet_convert_field(char **field);
 
 /* gpsbabel extensions */
 
 void cet_convert_init(const char *cs_name, const int force);
 void cet_convert_strings(const cet_cs_vec_t *source, const cet_cs_vec_t *target, const char *format);
+void cet_restore_strings(void);
 void cet_convert_deinit(void);
 
 void cet_disp_character_set_names(FILE *fout);
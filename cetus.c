@@ -601,7 +601,7 @@ data_write(void)
 	    bh->wpt = waypointp;
 	    if (global_opts.synthesize_shortnames && waypointp->description) {
 		if (waypointp->shortname)
-		    xfree(waypointp->shortname);
+		    strpool_release(waypointp->shortname);
 		waypointp->shortname = mkshort_from_wpt(mkshort_wr_handle, waypointp);
 	    }
 	    bh->wpt_name = waypointp->shortname;
@@ -61,7 +61,7 @@ cst_add_wpt(const route_head *track, waypoint *wpt)
 		waypt_add(waypt_dupe(wpt));
 		if (wpt->url != NULL)
 		{
-			xfree(wpt->url);
+			strpool_release(wpt->url);
 			wpt->url = NULL;
 		}
 		
@@ -29,6 +29,7 @@
 #include "jeeps/gpsmath.h"
 #include "xmlgeneric.h"  // for xml_fill_in_time.
 #include "garmin_fs.h"
+#include "gbnum.h"
 
 #define MYNAME "CSV_UTIL"
 
@@ -540,7 +541,7 @@ human_to_dec( const char *instr, double *outlat, double *outlon, int which )
 	    case '1': case '2': case '3': case '4': case '5':
 	    case '6': case '7': case '8': case '9': case '0': 
 	    case '.': case ',':
-		numres[numind] = atof(cur);
+		numres[numind] = gb_strtod(cur, NULL);
 		while (cur && *cur && strchr("1234567890.,",*cur)) cur++;
 		break;
 	    case '-':
@@ -1262,7 +1263,7 @@ xcsv_data_read(void)
 	csv_route = rte;
     }
 
-    while ((buff = gbfgetstr(xcsv_file.xcsvfp))) {
+    while ((buff = gbfgetline(xcsv_file.xcsvfp))) {
 	if ((linecount == 0) && xcsv_file.xcsvfp->unicode) cet_convert_init(CET_CHARSET_UTF8, 1);
 
         linecount++;
@@ -1467,7 +1468,7 @@ xcsv_waypt_pr(const waypoint *wpt)
 	}
 
         i++;
-#define writebuff(b, fmt, data) snprintf(b, sizeof(b), fmt, data)
+#define writebuff(b, fmt, data) gb_snprintf(b, sizeof(b), fmt, data)
     switch(fmp->hashed_key) {
         case XT_IGNORE:
             /* IGNORE -- Write the char printf conversion */
@@ -97,6 +97,39 @@ typedef struct char_map {
 	const char * chars;
 } char_map_t;
 
+/* an IFIELD or OFIELD of a compiled style */
+typedef struct xcsv_field_def {
+	char * key;
+	char * val;
+	char * printfc;
+	int options;
+} xcsv_field_def_t;
+
+/*
+ * A style file reduced to the values it sets, ready to be loaded into
+ * xcsv_file without parsing.  mkstyle.sh compiles the internal styles
+ * into these, so the layout here and there must agree.
+ */
+struct xcsv_style {
+    char * description;
+    char * extension;
+    char * field_delimiter;
+    char * record_delimiter;
+    char * badchars;		/* in the order the style adds them */
+    char * encoding;		/* NULL if not set */
+    char * datum;		/* NULL if not set */
+    ff_type type;
+    gpsdata_type datatype;
+    int shortlen;		/* -1 if not set */
+    int shortwhite;		/* -1 if not set */
+    char ** prologue;		/* NULL terminated, or NULL */
+    char ** epilogue;		/* NULL terminated, or NULL */
+    xcsv_field_def_t * ifield;
+    int ifield_ct;
+    xcsv_field_def_t * ofield;
+    int ofield_ct;
+};
+
 /* 
  * a type describing all the wonderful elements of xcsv files, in a 
  * nutshell.
@@ -37,6 +37,7 @@
 #include "cet.h"
 #include "cet_util.h"
 #include "inifile.h"
+#include "slab.h"
 #include "session.h"
 
 // Turn on Unicode in expat?
@@ -311,9 +312,13 @@ void fs_chain_add( format_specific_data **chain, format_specific_data *data );
 typedef struct fs_xml {
 	format_specific_data fs;
 	xml_tag *tag;
+	struct xml_tag_block *arena;	/* tags of a tree read from a file */
 } fs_xml;
 
 fs_xml *fs_xml_alloc( long type );
+xml_tag *fs_xml_tag_alloc( fs_xml *xml );
+void *fs_xml_calloc( fs_xml *xml, size_t count, size_t size );
+char *fs_xml_strdup( fs_xml *xml, const char *s );
 
 #define FS_GPX 0x67707800L
 #define FS_AN1W 0x616e3177L
@@ -456,6 +461,8 @@ typedef struct {
 	void *extra_data;	/* Extra data added by, say, a filter. */
 } waypoint;
 
+typedef struct track_columns track_columns_t;
+
 typedef struct {
 	queue Q;		/* Link onto parent list. */
 	queue waypoint_list;	/* List of child waypoints */
@@ -469,6 +476,7 @@ typedef struct {
         gb_color line_color;         /* Optional line color for rendering */
         int line_width;         /* in pixels (sigh).  < 0 is unknown. */
 	session_t *session;	/* pointer to a session struct */
+	struct track_columns *columns;	/* compact points, see route.c */
 } route_head;
 
 /*
@@ -548,12 +556,22 @@ unsigned int waypt_count(void);
 void set_waypt_count(unsigned int nc);
 void waypt_add_url(waypoint *wpt, char *link, char *url_link_text);
 void free_gpx_extras (xml_tag * tag);
-void xcsv_setup_internal_style(const char *style_buf);
-void xcsv_read_internal_style(const char *style_buf);
+typedef struct xcsv_style xcsv_style_t;
+void xcsv_setup_internal_style(const xcsv_style_t *style);
+void xcsv_read_internal_style(const xcsv_style_t *style);
 waypoint * find_waypt_by_name(const char *name);
+waypoint * find_waypt_by_name_ignore_case(const char *name);
+void waypt_drop_name_index(void);
 void waypt_backup(signed int *count, queue **head_bak);
 void waypt_restore(signed int count, queue *head_bak);
 
+typedef struct waypt_index waypt_index_t;
+waypt_index_t *waypt_index_new(void);
+void waypt_index_free(waypt_index_t *idx);
+void waypt_index_add(waypt_index_t *idx, waypoint *wpt);
+void waypt_index_del(waypt_index_t *idx, const waypoint *wpt);
+waypoint *waypt_index_find(const waypt_index_t *idx, const char *name, int ignore_case);
+
 geocache_data *waypt_alloc_gc_data(waypoint *wpt);
 int waypt_empty_gc_data(const waypoint *wpt);
 geocache_type gs_mktype(const char *t);
@@ -595,6 +613,10 @@ void track_restore( queue *head_bak);
 void track_append( queue *src );
 void route_flush( queue *head );
 void track_recompute( const route_head *trk, computed_trkdata **);
+void track_compact_all(void);
+void track_expand_all(void);
+void track_set_views(int ok);
+int track_get_views(void);
 
 /*
  * All shortname functions take a shortname handle as the first arg.
@@ -634,6 +656,13 @@ vmem_t 	vmem_alloc(size_t, int flags);
 void 	vmem_free(vmem_t*);
 void 	vmem_realloc(vmem_t*, size_t);
 
+/*
+ *  Shared strings (strpool.c).
+ */
+char *	strpool_intern(const char *s);
+char *	strpool_share(const char *s);
+void	strpool_release(char *s);
+
 
 #define ARGTYPE_UNKNOWN    0x00000000
 #define ARGTYPE_INT        0x00000001
@@ -742,7 +771,7 @@ typedef struct ff_vecs {
 
 typedef struct style_vecs {
 	const char *name;
-	const char *style_buf;
+	const xcsv_style_t *style;
 } style_vecs_t;
 extern style_vecs_t style_list[];
 
@@ -985,6 +1014,7 @@ time_t parse_date(const char *str, const char *format, const char *module);
  */
 unsigned long get_crc32(const void * data, int datalen);
 unsigned long get_crc32_s(const void * data);
+unsigned long get_crc32_s_append(unsigned long crc, const void * data);
 
 /*
  *  From units.c
@@ -757,7 +757,7 @@ exif_waypt_from_exif_app(exif_app_t *app)
 		if ((c = strrchr(cx, '/'))) cx = c + 1;
 		if (((c = strchr(cx, '.'))) && (c != cx)) *c = '\0';
 
-		if (wpt->shortname) xfree(wpt->shortname);
+		if (wpt->shortname) strpool_release(wpt->shortname);
 		wpt->shortname = xstrdup(cx);
 		xfree(str);
 	}
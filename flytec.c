@@ -33,6 +33,7 @@
 #include <sys/select.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <termios.h>
 #include <time.h>
 #include <unistd.h>
@@ -41,9 +42,21 @@
 
 
 static char *flytec_debug = 0;
+static char *flytec_log = 0;
+static char *flytec_timeout = 0;
+static char *flytec_igc_dir = 0;
+static char *flytec_igc_short = 0;
+static char *flytec_window = 0;
+static char *flytec_verify = 0;
 static
 arglist_t flytec_args[] = {
 	{ "debug", &flytec_debug, "Enable debugging", NULL, ARGTYPE_BOOL, ARG_NOMINMAX },
+	{ "log", &flytec_log, "Log communication to this file", NULL, ARGTYPE_STRING, ARG_NOMINMAX },
+	{ "timeout", &flytec_timeout, "Read timeout in milliseconds", NULL, ARGTYPE_INT, "1", NULL },
+	{ "igc_dir", &flytec_igc_dir, "Download only tracks missing from this directory", NULL, ARGTYPE_STRING, ARG_NOMINMAX },
+	{ "igc_short", &flytec_igc_short, "Use short (8.3) IGC filenames", NULL, ARGTYPE_BOOL, ARG_NOMINMAX },
+	{ "window", &flytec_window, "Number of sentences to upload before waiting for acknowledgement", "1", ARGTYPE_INT, "1", "64" },
+	{ "verify", &flytec_verify, "Verify uploaded waypoints", NULL, ARGTYPE_BOOL, ARG_NOMINMAX },
 	ARG_TERMINATOR
 };
 
@@ -90,9 +103,14 @@ typedef struct {
 	track_t **trackv;
 	int waypoint_count;
 	int waypoint_index;
+	int timeout;
+	int window;
+	int pending;
+	int uploadc;
+	waypoint **uploadv;
 	char *next;
 	char *end;
-	char buf[128];
+	char buf[65536];
 } flytec_t;
 
 	static void
@@ -166,6 +184,21 @@ match_unsigned(const char *p, int *result)
 	return p;
 }
 
+/* As match_unsigned, but with an optional leading minus sign. */
+	static inline const char *
+match_signed(const char *p, int *result)
+{
+	if (!p)
+		return 0;
+	if (*p == '-') {
+		p = match_unsigned(p + 1, result);
+		if (p)
+			*result = -*result;
+		return p;
+	}
+	return match_unsigned(p, result);
+}
+
 	static inline const char *
 match_one_of(const char *p, const char *s, char *result)
 {
@@ -293,6 +326,141 @@ match_hfdte_record(const char *p, struct tm *tm)
 	return p;
 }
 
+/* Parser state for the responses from one instrument. */
+typedef struct {
+	route_head *route;
+	route_head *track;
+	struct tm tm;
+	waypt_index_t *waypoints;
+} parse_t;
+
+/* Find a waypoint received from the same instrument by name. */
+	static const waypoint *
+parse_find_waypt(const parse_t *parse, const char *name)
+{
+	return parse->waypoints ? waypt_index_find(parse->waypoints, name, 0) : 0;
+}
+
+	static void
+parse_pbrrts(parse_t *parse, const char *line)
+{
+	const char *p = line;
+	p = match_literal(p, "PBRRTS,");
+	int index = 0, count = 0, routepoint_index = 0;
+	p = match_unsigned(p, &index);
+	p = match_char(p, ',');
+	p = match_unsigned(p, &count);
+	p = match_char(p, ',');
+	p = match_unsigned(p, &routepoint_index);
+	p = match_char(p, ',');
+	if (!p)
+		return;
+	if (routepoint_index == 0) {
+		char *name = 0;
+		p = match_string_until(p, '\0', 0, &name);
+		p = match_eos(p);
+		if (p) {
+			parse->route = route_head_alloc();
+			parse->route->rte_num = index + 1;
+			parse->route->rte_name = rstrip(name);
+			route_add_head(parse->route);
+		} else {
+			free(name);
+		}
+	} else {
+		char *name = 0;
+		p = match_string_until(p, ',', 1, 0);
+		p = match_string_until(p, '\0', 0, &name);
+		p = match_eos(p);
+		if (p && parse->route) {
+			const waypoint *w = parse_find_waypt(parse, rstrip(name));
+			if (w)
+				route_add_wpt(parse->route, waypt_dupe(w));
+		}
+		free(name);
+	}
+}
+
+/* Match the fields of a PBRWPR or PBRWPS sentence following its name. */
+	static waypoint *
+match_waypoint(const char *p)
+{
+	int lat_deg = 0, lat_min = 0, lat_mmin = 0;
+	p = match_n_digits(p, 2, &lat_deg);
+	p = match_n_digits(p, 2, &lat_min);
+	p = match_char(p, '.');
+	p = match_n_digits(p, 3, &lat_mmin);
+	p = match_char(p, ',');
+	char lat_hemi = '\0';
+	p = match_one_of(p, "NS", &lat_hemi);
+	p = match_char(p, ',');
+	int lon_deg = 0, lon_min = 0, lon_mmin = 0;
+	p = match_n_digits(p, 3, &lon_deg);
+	p = match_n_digits(p, 2, &lon_min);
+	p = match_char(p, '.');
+	p = match_n_digits(p, 3, &lon_mmin);
+	p = match_char(p, ',');
+	char lon_hemi = '\0';
+	p = match_one_of(p, "EW", &lon_hemi);
+	p = match_char(p, ',');
+	char *name = 0;
+	p = match_string_until(p, ',', 1, 0);
+	p = match_string_until(p, ',', 1, &name);
+	int ele = 0;
+	p = match_signed(p, &ele);
+	p = match_eos(p);
+	if (!p) {
+		free(name);
+		return 0;
+	}
+	waypoint *w = waypt_new();
+	w->latitude = lat_deg + lat_min / 60.0 + lat_mmin / 60000.0;
+	if (lat_hemi == 'S')
+		w->latitude = -w->latitude;
+	w->longitude = lon_deg + lon_min / 60.0 + lon_mmin / 60000.0;
+	if (lon_hemi == 'W')
+		w->longitude = -w->longitude;
+	w->altitude = ele;
+	w->shortname = rstrip(name);
+	return w;
+}
+
+	static void
+parse_pbrwps(parse_t *parse, const char *line)
+{
+	waypoint *w = match_waypoint(match_literal(line, "PBRWPS,"));
+	if (!w)
+		return;
+	waypt_add(w);
+	if (!parse->waypoints)
+		parse->waypoints = waypt_index_new();
+	waypt_index_add(parse->waypoints, w);
+}
+
+/* Handle one line of a PBRWPS, PBRRTS, PBRIGC or PBRTR response. */
+	static void
+parse_line(void *data, const char *line)
+{
+	parse_t *parse = data;
+	if (match_literal(line, "PBRWPS,")) {
+		parse_pbrwps(parse, line);
+	} else if (match_literal(line, "PBRRTS,")) {
+		parse_pbrrts(parse, line);
+	} else {
+		switch (line[0]) {
+			case 'A':
+				parse->track = 0;
+				break;
+			case 'B':
+				match_b_record(line, &parse->tm, &parse->track);
+				break;
+			case 'H':
+				match_hfdte_record(line, &parse->tm);
+				break;
+		}
+	}
+}
+
 	static const char *
 manufacturer_new(const char *instrument_id)
 {
@@ -419,6 +587,8 @@ flytec_new(const char *device, FILE *logfile)
 	if (tcsetattr(flytec->fd, TCSANOW, &termios) == -1)
 		fatal(MYNAME ":tcsetattr: %s: %s\n", flytec->device, strerror(errno));
 	flytec->logfile = logfile;
+	flytec->timeout = 250;
+	flytec->window = 1;
 	return flytec;
 }
 
@@ -436,21 +606,34 @@ flytec_delete(flytec_t *flytec)
 		if (close(flytec->fd) == -1)
 			DIE("close", errno);
 		free(flytec->pilot_name);
+		int i;
+		for (i = 0; i < flytec->uploadc; ++i)
+			if (flytec->uploadv[i])
+				waypt_free(flytec->uploadv[i]);
+		free(flytec->uploadv);
 		free(flytec);
 	}
 }
 
+/* Append whatever data is available to the buffer. */
 	static void
 flytec_fill(flytec_t *flytec)
 {
+	if (flytec->next != flytec->buf) {
+		memmove(flytec->buf, flytec->next, flytec->end - flytec->next);
+		flytec->end -= flytec->next - flytec->buf;
+		flytec->next = flytec->buf;
+	}
+	if (flytec->end == flytec->buf + sizeof flytec->buf)
+		DIE(__FUNCTION__, 0);
 	fd_set readfds;
-	FD_ZERO(&readfds);
-	FD_SET(flytec->fd, &readfds);
 	int rc;
 	do {
+		FD_ZERO(&readfds);
+		FD_SET(flytec->fd, &readfds);
 		struct timeval timeout;
-		timeout.tv_sec = 0;
-		timeout.tv_usec = 250 * 1000;
+		timeout.tv_sec = flytec->timeout / 1000;
+		timeout.tv_usec = (flytec->timeout % 1000) * 1000;
 		rc = select(flytec->fd + 1, &readfds, 0, 0, &timeout);
 	} while (rc == -1 && errno == EINTR);
 	if (rc == -1)
@@ -461,14 +644,13 @@ flytec_fill(flytec_t *flytec)
 		DIE("select", 0);
 	int n;
 	do {
-		n = read(flytec->fd, flytec->buf, sizeof flytec->buf);
+		n = read(flytec->fd, flytec->end, flytec->buf + sizeof flytec->buf - flytec->end);
 	} while (n == -1 && errno == EINTR);
 	if (n == -1)
 		DIE("read", errno);
 	else if (n == 0)
 		DIE("read", 0);
-	flytec->next = flytec->buf;
-	flytec->end = flytec->buf + n;
+	flytec->end += n;
 }
 
 	static int
@@ -476,8 +658,6 @@ flytec_getc(flytec_t *flytec)
 {
 	if (flytec->next == flytec->end)
 		flytec_fill(flytec);
-	if (flytec->next == flytec->end)
-		return EOF;
 	return *flytec->next++;
 }
 
@@ -502,15 +682,58 @@ flytec_puts_nmea(flytec_t *flytec, char *s)
 		DIE("snprintf", 0);
 	if (flytec->logfile)
 		fprintf(flytec->logfile, "> %s", buf);
-	int rc;
-	do {
-		rc = write(flytec->fd, buf, len);
-	} while (rc == -1 && errno == EINTR);
-	if (rc == -1)
-		DIE("write", errno);
+	const char *next = buf;
+	int n = len - 1;
+	while (n > 0) {
+		int rc = write(flytec->fd, next, n);
+		if (rc == -1 && errno == EAGAIN) {
+			fd_set writefds;
+			FD_ZERO(&writefds);
+			FD_SET(flytec->fd, &writefds);
+			rc = select(flytec->fd + 1, 0, &writefds, 0, 0);
+			if (rc == -1 && errno != EINTR)
+				DIE("select", errno);
+			continue;
+		} else if (rc == -1) {
+			if (errno == EINTR)
+				continue;
+			DIE("write", errno);
+		}
+		next += rc;
+		n -= rc;
+	}
 	free(buf);
 }
 
+/* Wait for the instrument to acknowledge the oldest pending sentence. */
+	static void
+flytec_ack(flytec_t *flytec)
+{
+	flytec_expectc(flytec, XOFF);
+	flytec_expectc(flytec, XON);
+	--flytec->pending;
+}
+
+/*
+ * Send a sentence that the instrument acknowledges with XOFF XON, keeping at
+ * most flytec->window sentences unacknowledged.
+ */
+	static void
+flytec_puts_nmea_pipelined(flytec_t *flytec, char *s)
+{
+	while (flytec->pending >= flytec->window)
+		flytec_ack(flytec);
+	flytec_puts_nmea(flytec, s);
+	++flytec->pending;
+}
+
+	static void
+flytec_drain(flytec_t *flytec)
+{
+	while (flytec->pending)
+		flytec_ack(flytec);
+}
+
 	static char *
 flytec_gets(flytec_t *flytec, char *buf, int size)
 {
@@ -518,33 +741,34 @@ flytec_gets(flytec_t *flytec, char *buf, int size)
 		flytec_fill(flytec);
 	if (*flytec->next == XON)
 		return 0;
-	int len = size;
-	char *p = buf;
-	while (1) {
-		if (--len <= 0)
-			DIE(__FUNCTION__, 0);
-		if ((*p++ = *flytec->next++) == '\n') {
-			*p = '\0';
-			if (flytec->logfile)
-				fprintf(flytec->logfile, "< %s", buf);
-			return buf;
-		}
-		if (flytec->next == flytec->end)
-			flytec_fill(flytec);
+	int scanned = 0;
+	char *eol;
+	while (!(eol = memchr(flytec->next + scanned, '\n', flytec->end - flytec->next - scanned))) {
+		scanned = flytec->end - flytec->next;
+		flytec_fill(flytec);
 	}
+	int len = eol + 1 - flytec->next;
+	if (len >= size)
+		DIE(__FUNCTION__, 0);
+	memcpy(buf, flytec->next, len);
+	buf[len] = '\0';
+	flytec->next = eol + 1;
+	if (flytec->logfile) {
+		fputs("< ", flytec->logfile);
+		fwrite(buf, len, 1, flytec->logfile);
+	}
+	return buf;
 }
 
+/* Check and strip the $ and checksum from an NMEA sentence in place. */
 	static char *
-flytec_gets_nmea(flytec_t *flytec, char *buf, int size)
+nmea_strip(char *buf)
 {
-	buf = flytec_gets(flytec, buf, size);
-	if (!buf)
-		return 0;
 	int len = strlen(buf);
 	if (len < 6)
-		goto _error;
+		return 0;
 	if (buf[0] != '$' || buf[len - 5] != '*' || buf[len - 2] != '\r' || buf[len - 1] != '\n')
-		goto _error;
+		return 0;
 	int checksum = 0;
 	char *p;
 	for (p = buf + 1; p != buf + len - 5; ++p)
@@ -556,90 +780,51 @@ flytec_gets_nmea(flytec_t *flytec, char *buf, int size)
 	else if ('A' <= xdigit && xdigit <= 'F')
 		result = (xdigit - 'A' + 0xa) << 4;
 	else
-		goto _error;
+		return 0;
 	xdigit = buf[len - 3];
 	if ('0' <= xdigit && xdigit <= '9')
 		result += xdigit - '0';
 	else if ('A' <= xdigit && xdigit <= 'F')
 		result += xdigit - 'A' + 0xa;
 	else
-		goto _error;
+		return 0;
 	if (checksum != result)
-		goto _error;
+		return 0;
 	memmove(buf, buf + 1, len - 5);
 	buf[len - 6] = '\0';
 	return buf;
-_error:
-	fatal(MYNAME ":%s: invalid NMEA response\n", flytec->device);
-	return 0;
+}
+
+	static char *
+flytec_gets_nmea(flytec_t *flytec, char *buf, int size)
+{
+	buf = flytec_gets(flytec, buf, size);
+	if (!buf)
+		return 0;
+	if (!nmea_strip(buf))
+		fatal(MYNAME ":%s: invalid NMEA response\n", flytec->device);
+	return buf;
 }
 
 	static void
-flytec_pbrigc(flytec_t *flytec)
+flytec_pbrigc(flytec_t *flytec, void (*callback)(void *, const char *), void *data)
 {
 	flytec_puts_nmea(flytec, "PBRIGC,");
 	flytec_expectc(flytec, XOFF);
 	char line[128];
-	route_head *track = 0;
-	struct tm tm;
-	memset(&tm, 0, sizeof tm);
-	while (flytec_gets(flytec, line, sizeof line)) {
-		switch (line[0]) {
-			case 'B':
-				match_b_record(line, &tm, &track);
-				break;
-			case 'H':
-				match_hfdte_record(line, &tm);
-				break;
-		}
-	}
+	while (flytec_gets(flytec, line, sizeof line))
+		callback(data, line);
 	flytec_expectc(flytec, XON);
 }
 
 	static void
-flytec_pbrrts(flytec_t *flytec)
+flytec_pbrrts(flytec_t *flytec, void (*callback)(void *, const char *), void *data)
 {
 	flytec_puts_nmea(flytec, "PBRRTS,");
 	flytec_expectc(flytec, XOFF);
-	route_head *route = 0;
 	char line[128];
-	while (flytec_gets_nmea(flytec, line, sizeof line)) {
-		const char *p = line;
-		p = match_literal(p, "PBRRTS,");
-		int index = 0, count = 0, routepoint_index = 0;
-		p = match_unsigned(p, &index);
-		p = match_char(p, ',');
-		p = match_unsigned(p, &count);
-		p = match_char(p, ',');
-		p = match_unsigned(p, &routepoint_index);
-		p = match_char(p, ',');
-		if (!p)
-			continue;
-		if (routepoint_index == 0) {
-			char *name = 0;
-			p = match_string_until(p, '\0', 0, &name);
-			p = match_eos(p);
-			if (p) {
-				route = route_head_alloc();
-				route->rte_num = index + 1;
-				route->rte_name = rstrip(name);
-				route_add_head(route);
-			} else {
-				free(name);
-			}
-		} else {
-			char *name = 0;
-			p = match_string_until(p, ',', 1, 0);
-			p = match_string_until(p, '\0', 0, &name);
-			p = match_eos(p);
-			if (p) {
-				const waypoint *w = find_waypt_by_name(rstrip(name));
-				if (w)
-					route_add_wpt(route, waypt_dupe(w));
-			}
-			free(name);
-		}
-	}
+	while (flytec_gets_nmea(flytec, line, sizeof line))
+		callback(data, line);
 	flytec_expectc(flytec, XON);
 }
 
@@ -670,6 +855,7 @@ flytec_pbrsnp(flytec_t *flytec)
 	memcpy(flytec->pilot_name, pilot_name, pilot_name_end - pilot_name);
 	flytec->pilot_name[pilot_name_end - pilot_name] = '\0';
 	flytec->serial_number = flytec->snp->serial_number;
+	flytec->manufacturer = manufacturer_new(flytec->snp->instrument_id);
 	return flytec->snp;
 }
 
@@ -678,8 +864,8 @@ flytec_pbrtl(flytec_t *flytec, const char *manufacturer, int filename_format)
 {
 	if (flytec->trackv)
 		return flytec->trackv;
-	manufacturer = manufacturer ? manufacturer : flytec->manufacturer;
 	flytec_pbrsnp(flytec);
+	manufacturer = manufacturer ? manufacturer : flytec->manufacturer;
 	flytec_puts_nmea(flytec, "PBRTL,");
 	flytec_expectc(flytec, XOFF);
 	char line[128];
@@ -759,83 +945,270 @@ flytec_pbrtr(flytec_t *flytec, track_t *track, void (*callback)(void *, const ch
 }
 
 	static void
-flytec_pbrwps(flytec_t *flytec)
+flytec_pbrwps(flytec_t *flytec, void (*callback)(void *, const char *), void *data)
 {
 	flytec_puts_nmea(flytec, "PBRWPS,");
 	flytec_expectc(flytec, XOFF);
 	char line[128];
-	while (flytec_gets_nmea(flytec, line, sizeof line)) {
-		const char *p = line;
-		p = match_literal(p, "PBRWPS,");
-		int lat_deg = 0, lat_min = 0, lat_mmin = 0;
-		p = match_n_digits(p, 2, &lat_deg);
-		p = match_n_digits(p, 2, &lat_min);
-		p = match_char(p, '.');
-		p = match_n_digits(p, 3, &lat_mmin);
-		p = match_char(p, ',');
-		char lat_hemi = '\0';
-		p = match_one_of(p, "NS", &lat_hemi);
-		p = match_char(p, ',');
-		int lon_deg = 0, lon_min = 0, lon_mmin = 0;
-		p = match_n_digits(p, 3, &lon_deg);
-		p = match_n_digits(p, 2, &lon_min);
-		p = match_char(p, '.');
-		p = match_n_digits(p, 3, &lon_mmin);
-		p = match_char(p, ',');
-		char lon_hemi = '\0';
-		p = match_one_of(p, "EW", &lon_hemi);
-		p = match_char(p, ',');
-		char *name = 0;
-		p = match_string_until(p, ',', 1, 0);
-		p = match_string_until(p, ',', 1, &name);
-		int ele = 0;
-		p = match_unsigned(p, &ele);
-		p = match_eos(p);
-		if (p) {
-			waypoint *w = waypt_new();
-			w->latitude = lat_deg + lat_min / 60.0 + lat_mmin / 60000.0;
-			if (lat_hemi == 'S')
-				w->latitude = -w->latitude;
-			w->longitude = lon_deg + lon_min / 60.0 + lon_mmin / 60000.0;
-			if (lon_hemi == 'W')
-				w->longitude = -w->longitude;
-			w->altitude = ele;
-			w->shortname = rstrip(name);
-			waypt_add(w);
-		} else {
-			free(name);
+	while (flytec_gets_nmea(flytec, line, sizeof line))
+		callback(data, line);
+	flytec_expectc(flytec, XON);
+}
+
+typedef struct {
+	FILE *file;
+	void (*callback)(void *, const char *);
+	void *data;
+} igc_download_t;
+
+	static void
+igc_download_callback(void *data, const char *line)
+{
+	igc_download_t *igc_download = data;
+	if (fputs(line, igc_download->file) == EOF)
+		DIE("fputs", errno);
+	igc_download->callback(igc_download->data, line);
+}
+
+/* Download each track that does not already have an IGC file in dir. */
+	static void
+flytec_igc_download(flytec_t *flytec, const char *dir, int filename_format, void (*callback)(void *, const char *), void *data)
+{
+	struct stat st;
+	if (stat(dir, &st) == -1)
+		fatal(MYNAME ":stat: %s: %s\n", dir, strerror(errno));
+	if (!S_ISDIR(st.st_mode))
+		fatal(MYNAME ":%s: not a directory\n", dir);
+	track_t **track;
+	for (track = flytec_pbrtl(flytec, 0, filename_format); *track; ++track) {
+		char *filename = 0;
+		xasprintf(&filename, "%s/%s", dir, (*track)->igc_filename);
+		if (stat(filename, &st) == 0) {
+			free(filename);
+			continue;
+		} else if (errno != ENOENT) {
+			fatal(MYNAME ":stat: %s: %s\n", filename, strerror(errno));
 		}
+		/* write to a temporary file so that an interrupted download is retried */
+		char *tmp_filename = 0;
+		xasprintf(&tmp_filename, "%s.part", filename);
+		igc_download_t igc_download;
+		igc_download.callback = callback;
+		igc_download.data = data;
+		igc_download.file = fopen(tmp_filename, "wb");
+		if (!igc_download.file)
+			fatal(MYNAME ":fopen: %s: %s\n", tmp_filename, strerror(errno));
+		flytec_pbrtr(flytec, *track, igc_download_callback, &igc_download);
+		if (fclose(igc_download.file) == EOF)
+			fatal(MYNAME ":fclose: %s: %s\n", tmp_filename, strerror(errno));
+		if (rename(tmp_filename, filename) == -1)
+			fatal(MYNAME ":rename: %s: %s\n", filename, strerror(errno));
+		free(tmp_filename);
+		free(filename);
 	}
-	flytec_expectc(flytec, XON);
+}
+
+/* Download waypoints, routes and tracks, passing each line to callback. */
+	static void
+flytec_download(flytec_t *flytec, void (*callback)(void *, const char *), void *data)
+{
+	flytec_pbrwps(flytec, callback, data);
+	flytec_pbrrts(flytec, callback, data);
+	if (flytec_igc_dir)
+		flytec_igc_download(flytec, flytec_igc_dir, flytec_igc_short ? 1 : 0, callback, data);
+	else
+		flytec_pbrigc(flytec, callback, data);
+}
+
+/* Lines are recorded with their length as they may contain newlines. */
+	static void
+record_line(void *data, const char *line)
+{
+	int len = strlen(line);
+	if (fwrite(&len, sizeof len, 1, data) != 1 || fwrite(line, len, 1, data) != 1)
+		DIE("fwrite", errno);
+}
+
+/* Append the rest of the temporary file src to dest. */
+	static void
+append_file(FILE *dest, FILE *src)
+{
+	char buf[4096];
+	size_t len;
+	rewind(src);
+	while ((len = fread(buf, 1, sizeof buf, src)) > 0)
+		if (fwrite(buf, 1, len, dest) != len)
+			DIE("fwrite", errno);
+	if (ferror(src))
+		DIE("fread", errno);
+}
+
+/*
+ * Download from several instruments at once.  Each instrument is driven by
+ * its own child process which records the responses to a temporary file.
+ * Once all the downloads have finished the responses are parsed in order,
+ * each instrument into its own session.  A child also logs to a temporary
+ * file of its own, which is appended to the log in the same order, so that
+ * the children neither lose nor interleave their logs.
+ */
+	static void
+flytec_download_concurrent(flytec_t **flytecv)
+{
+	int flytecc = 0;
+	while (flytecv[flytecc])
+		++flytecc;
+	FILE **filev = xmalloc(flytecc * sizeof(FILE *));
+	FILE **logv = xcalloc(flytecc, sizeof(FILE *));
+	pid_t *pidv = xmalloc(flytecc * sizeof(pid_t));
+	int i;
+	fflush(0);
+	for (i = 0; i < flytecc; ++i) {
+		filev[i] = tmpfile();
+		if (!filev[i])
+			DIE("tmpfile", errno);
+		if (flytecv[i]->logfile) {
+			logv[i] = tmpfile();
+			if (!logv[i])
+				DIE("tmpfile", errno);
+		}
+		pidv[i] = fork();
+		if (pidv[i] == -1)
+			DIE("fork", errno);
+		if (pidv[i] == 0) {
+			if (logv[i])
+				flytecv[i]->logfile = logv[i];
+			flytec_download(flytecv[i], record_line, filev[i]);
+			if (fflush(filev[i]) == EOF || (logv[i] && fflush(logv[i]) == EOF))
+				DIE("fflush", errno);
+			_exit(0);
+		}
+	}
+	int failed = 0;
+	for (i = 0; i < flytecc; ++i) {
+		int status, rc;
+		do {
+			rc = waitpid(pidv[i], &status, 0);
+		} while (rc == -1 && errno == EINTR);
+		if (rc == -1)
+			DIE("waitpid", errno);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			failed = 1;
+	}
+	for (i = 0; i < flytecc; ++i) {
+		if (logv[i]) {
+			append_file(flytecv[i]->logfile, logv[i]);
+			fclose(logv[i]);
+		}
+	}
+	if (failed)
+		fatal(MYNAME ": download failed\n");
+	for (i = 0; i < flytecc; ++i) {
+		start_session(MYNAME, flytecv[i]->device);
+		parse_t parse;
+		memset(&parse, 0, sizeof parse);
+		rewind(filev[i]);
+		char line[2048];
+		int len;
+		while (fread(&len, sizeof len, 1, filev[i]) == 1) {
+			if (len < 0 || len >= (int) sizeof line || fread(line, len, 1, filev[i]) != 1)
+				DIE("fread", errno);
+			line[len] = '\0';
+			parse_line(&parse, line);
+		}
+		if (ferror(filev[i]))
+			DIE("fread", errno);
+		fclose(filev[i]);
+		if (parse.waypoints)
+			waypt_index_free(parse.waypoints);
+	}
+	free(pidv);
+	free(logv);
+	free(filev);
 }
 
 /*******************************************************************************
  * %%%		 global callbacks called by gpsbabel main process			   %%% *
  *******************************************************************************/
 
-static flytec_t *flytec_rd = 0;
+static FILE *flytec_logfile = 0;
+
+/* Return the log requested by the log or debug options. */
+	static FILE *
+logfile_open(void)
+{
+	if (flytec_log) {
+		if (!flytec_logfile) {
+			flytec_logfile = xfopen(flytec_log, "w", MYNAME);
+			setvbuf(flytec_logfile, 0, _IOFBF, 65536);
+		}
+		return flytec_logfile;
+	}
+	return flytec_debug ? stderr : 0;
+}
 
+	static void
+logfile_close(void)
+{
+	if (flytec_logfile) {
+		if (fclose(flytec_logfile) == EOF)
+			fatal(MYNAME ":fclose: %s: %s\n", flytec_log, strerror(errno));
+		flytec_logfile = 0;
+	}
+}
+
+static flytec_t **flytec_rdv = 0;
+
+/* fname is a device or a comma-separated list of devices */
 	static void
 flytec_rd_init(const char *fname)
 {
-	flytec_rd = flytec_new(fname, flytec_debug ? stderr : 0);
+	int flytecc = 0;
+	flytec_rdv = xmalloc(sizeof(flytec_t *));
+	const char *device = fname;
+	while (1) {
+		const char *end = strchr(device, ',');
+		char *name = end ? xstrndup(device, end - device) : xstrdup(device);
+		flytec_rdv = xrealloc(flytec_rdv, (flytecc + 2) * sizeof(flytec_t *));
+		flytec_rdv[flytecc] = flytec_new(name, logfile_open());
+		if (flytec_timeout)
+			flytec_rdv[flytecc]->timeout = atoi(flytec_timeout);
+		++flytecc;
+		flytec_rdv[flytecc] = 0;
+		if (!end)
+			break;
+		device = end + 1;
+	}
 }
 
 	static void 
 flytec_rd_deinit(void)
 {
-	flytec_delete(flytec_rd);
+	flytec_t **flytec;
+	for (flytec = flytec_rdv; *flytec; ++flytec) {
+		char *device = (char *) (*flytec)->device;
+		flytec_delete(*flytec);
+		free(device);
+	}
+	free(flytec_rdv);
+	flytec_rdv = 0;
+	logfile_close();
 }
 
 	static void
 flytec_read(void)
 {
-	flytec_pbrwps(flytec_rd);
-	flytec_pbrrts(flytec_rd);
 	char *tz = getenv("TZ");
 	setenv("TZ", "", 1);
 	tzset();
-	flytec_pbrigc(flytec_rd);
+	if (flytec_rdv[1]) {
+		flytec_download_concurrent(flytec_rdv);
+	} else {
+		parse_t parse;
+		memset(&parse, 0, sizeof parse);
+		flytec_download(flytec_rdv[0], parse_line, &parse);
+		if (parse.waypoints)
+			waypt_index_free(parse.waypoints);
+	}
 	if (tz)
 		setenv("TZ", tz, 1);
 	else
@@ -843,18 +1216,149 @@ flytec_read(void)
 	tzset();
 }
 
+/*
+ * Realtime tracking.  The instrument sends GPRMC and GPGGA sentences for
+ * each fix, a waypoint is returned as soon as both have been received or
+ * when a sentence for a later fix arrives.
+ */
+
+enum {
+	POSN_RMC = 1,
+	POSN_GGA = 2,
+};
+
+static flytec_t *flytec_posn = 0;
+static waypoint *flytec_posn_wpt = 0;
+static int flytec_posn_time = -1;
+static int flytec_posn_have = 0;
+static struct tm flytec_posn_tm;
+
+/* Split an NMEA sentence into at most n comma-separated fields in place. */
+	static int
+nmea_split(char *s, char **fieldv, int n)
+{
+	int fieldc = 0;
+	while (fieldc < n) {
+		fieldv[fieldc++] = s;
+		s = strchr(s, ',');
+		if (!s)
+			break;
+		*s++ = '\0';
+	}
+	return fieldc;
+}
+
+	static double
+nmea_degrees(const char *value, const char *hemi)
+{
+	double ddmm = atof(value);
+	double degrees = (int) (ddmm / 100.0) + fmod(ddmm, 100.0) / 60.0;
+	return *hemi == 'S' || *hemi == 'W' ? -degrees : degrees;
+}
+
+	static void
+flytec_rd_posn_init(const char *fname)
+{
+	flytec_posn = flytec_new(fname, logfile_open());
+	/* the instrument sends a fix every second */
+	flytec_posn->timeout = flytec_timeout ? atoi(flytec_timeout) : 5000;
+	memset(&flytec_posn_tm, 0, sizeof flytec_posn_tm);
+}
+
+	static waypoint *
+flytec_rd_posn(posn_status *posn_status)
+{
+	char line[1024];
+	while (!posn_status->request_terminate) {
+		if (!flytec_gets(flytec_posn, line, sizeof line)) {
+			++flytec_posn->next;	/* skip stray XON */
+			continue;
+		}
+		if (!nmea_strip(line))
+			continue;
+		char *fieldv[16];
+		int fieldc = nmea_split(line, fieldv, 16);
+		int have;
+		if (!strcmp(fieldv[0], "GPRMC") && fieldc >= 10 && *fieldv[2] == 'A')
+			have = POSN_RMC;
+		else if (!strcmp(fieldv[0], "GPGGA") && fieldc >= 10 && atoi(fieldv[6]) > 0)
+			have = POSN_GGA;
+		else
+			continue;
+		int time = atoi(fieldv[1]);
+		waypoint *result = 0;
+		if (flytec_posn_wpt && time != flytec_posn_time) {
+			result = flytec_posn_wpt;
+			flytec_posn_wpt = 0;
+		}
+		if (!flytec_posn_wpt) {
+			flytec_posn_wpt = waypt_new();
+			flytec_posn_time = time;
+			flytec_posn_have = 0;
+		}
+		waypoint *w = flytec_posn_wpt;
+		flytec_posn_tm.tm_hour = time / 10000;
+		flytec_posn_tm.tm_min = (time / 100) % 100;
+		flytec_posn_tm.tm_sec = time % 100;
+		if (have == POSN_RMC) {
+			w->latitude = nmea_degrees(fieldv[3], fieldv[4]);
+			w->longitude = nmea_degrees(fieldv[5], fieldv[6]);
+			WAYPT_SET(w, speed, KNOTS_TO_MPS(atof(fieldv[7])));
+			WAYPT_SET(w, course, atof(fieldv[8]));
+			int date = atoi(fieldv[9]);
+			flytec_posn_tm.tm_mday = date / 10000;
+			flytec_posn_tm.tm_mon = (date / 100) % 100 - 1;
+			flytec_posn_tm.tm_year = date % 100 + 100;
+		} else {
+			w->latitude = nmea_degrees(fieldv[2], fieldv[3]);
+			w->longitude = nmea_degrees(fieldv[4], fieldv[5]);
+			w->fix = fix_3d;
+			w->sat = atoi(fieldv[7]);
+			w->hdop = atof(fieldv[8]);
+			w->altitude = atof(fieldv[9]);
+		}
+		if (flytec_posn_tm.tm_year)
+			w->creation_time = mkgmtime(&flytec_posn_tm);
+		flytec_posn_have |= have;
+		if (result)
+			return result;
+		if (flytec_posn_have == (POSN_RMC | POSN_GGA)) {
+			result = flytec_posn_wpt;
+			flytec_posn_wpt = 0;
+			return result;
+		}
+	}
+	return 0;
+}
+
+	static void
+flytec_rd_posn_deinit(void)
+{
+	if (flytec_posn_wpt) {
+		waypt_free(flytec_posn_wpt);
+		flytec_posn_wpt = 0;
+	}
+	flytec_delete(flytec_posn);
+	flytec_posn = 0;
+	logfile_close();
+}
+
 static flytec_t *flytec_wr = 0;
 
 	static void
 flytec_wr_init(const char *fname)
 {
-	flytec_wr = flytec_new(fname, flytec_debug ? stderr : 0);
+	flytec_wr = flytec_new(fname, logfile_open());
+	if (flytec_timeout)
+		flytec_wr->timeout = atoi(flytec_timeout);
+	flytec_wr->window = atoi(flytec_window);
 }
 
 	static void
 flytec_wr_deinit(void)
 {
 	flytec_delete(flytec_wr);
+	logfile_close();
 }
 
 	static void
@@ -868,9 +1372,7 @@ flytec_route_write_head(const route_head *r)
 	char buffer[128];
 	if (snprintf(buffer, sizeof buffer, "PBRRTR,99,%02d,00,%-17s", flytec_wr->waypoint_count + 1, name) != 33)
 		fatal(MYNAME ":snprintf\n");
-	flytec_puts_nmea(flytec_wr, buffer);
-	flytec_expectc(flytec_wr, XOFF);
-	flytec_expectc(flytec_wr, XON);
+	flytec_puts_nmea_pipelined(flytec_wr, buffer);
 }
 
 	static void
@@ -882,9 +1384,7 @@ flytec_route_write_waypoint(const waypoint *w)
 	char buffer[128];
 	if (snprintf(buffer, sizeof buffer, "PBRRTR,99,%02d,%02d,,%-17s", flytec_wr->waypoint_count + 1, ++flytec_wr->waypoint_index, name) != 34)
 		fatal(MYNAME ":snprintf\n");
-	flytec_puts_nmea(flytec_wr, buffer);
-	flytec_expectc(flytec_wr, XOFF);
-	flytec_expectc(flytec_wr, XON);
+	flytec_puts_nmea_pipelined(flytec_wr, buffer);
 }
 
 	static void
@@ -910,9 +1410,38 @@ flytec_waypoint_write(const waypoint *w)
 	char buffer[64];
 	if (snprintf(buffer, sizeof buffer, "PBRWPR,%02ld%06.3f,%c,%03ld%06.3f,%c,,%-17s,%04ld", lat_deg, lat_min, lat_hemi, lon_deg, lon_min, lon_hemi, name, ele) != 53)
 		DIE("snprintf", errno);
-	flytec_puts_nmea(flytec_wr, buffer);
-	flytec_expectc(flytec_wr, XOFF);
-	flytec_expectc(flytec_wr, XON);
+	flytec_puts_nmea_pipelined(flytec_wr, buffer);
+	if (flytec_verify) {
+		waypoint *upload = match_waypoint(match_literal(buffer, "PBRWPR,"));
+		if (!upload)
+			fatal(MYNAME ":%s: cannot verify waypoint %s\n", flytec_wr->device, name);
+		flytec_wr->uploadv = xrealloc(flytec_wr->uploadv, (flytec_wr->uploadc + 1) * sizeof(waypoint *));
+		flytec_wr->uploadv[flytec_wr->uploadc++] = upload;
+	}
+}
+
+/* Tick off each uploaded waypoint that the instrument reports. */
+	static void
+verify_line(void *data, const char *line)
+{
+	flytec_t *flytec = data;
+	waypoint *w = match_waypoint(match_literal(line, "PBRWPS,"));
+	if (!w)
+		return;
+	int i;
+	for (i = 0; i < flytec->uploadc; ++i) {
+		waypoint *upload = flytec->uploadv[i];
+		if (upload &&
+				!strcmp(upload->shortname, w->shortname) &&
+				upload->latitude == w->latitude &&
+				upload->longitude == w->longitude &&
+				upload->altitude == w->altitude) {
+			waypt_free(upload);
+			flytec->uploadv[i] = 0;
+			break;
+		}
+	}
+	waypt_free(w);
 }
 
 	static void
@@ -920,6 +1449,18 @@ flytec_write(void)
 {
 	waypt_disp_all(flytec_waypoint_write);
 	route_disp_all(flytec_route_write_head, 0, flytec_route_write_waypoint);
+	flytec_drain(flytec_wr);
+	if (flytec_verify) {
+		flytec_pbrwps(flytec_wr, verify_line, flytec_wr);
+		int i, missing = 0;
+		for (i = 0; i < flytec_wr->uploadc; ++i)
+			if (flytec_wr->uploadv[i]) {
+				warning(MYNAME ":%s: waypoint %s not uploaded\n", flytec_wr->device, flytec_wr->uploadv[i]->shortname);
+				++missing;
+			}
+		if (missing)
+			fatal(MYNAME ":%s: %d of %d waypoints not uploaded\n", flytec_wr->device, missing, flytec_wr->uploadc);
+	}
 }
 
 	static void
@@ -947,7 +1488,8 @@ ff_vecs_t flytec_vecs = {
 	flytec_write,
 	flytec_exit,
 	flytec_args,
-	CET_CHARSET_ASCII, 0			/* ascii is the expected character set */
+	CET_CHARSET_ASCII, 0,			/* ascii is the expected character set */
 		/* not fixed, can be changed through command line parameter */
+	{ flytec_rd_posn_init, flytec_rd_posn, flytec_rd_posn_deinit, NULL, NULL, NULL }
 };
 /**************************************************************************/
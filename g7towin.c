@@ -128,7 +128,7 @@ parse_line(char *buff, int index, const char *delimiter, waypoint *wpt)
 
 			case WPT_cA_OFS + 1:
 			case WPT_c1_OFS + 1:
-				if (wpt->shortname) xfree(wpt->shortname);
+				if (wpt->shortname) strpool_release(wpt->shortname);
 				wpt->shortname = xstrdup(cin);
 				break;
 
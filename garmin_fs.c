@@ -118,18 +118,18 @@ void garmin_fs_convert(void *fs)
 {
 	garmin_fs_t *gmsd = (garmin_fs_t *) fs;
 	
-	if (gmsd->addr) gmsd->addr = cet_convert_string(gmsd->addr);
-	if (gmsd->cc) gmsd->cc = cet_convert_string(gmsd->cc);
-	if (gmsd->city) gmsd->city = cet_convert_string(gmsd->city);
-	if (gmsd->country) gmsd->country = cet_convert_string(gmsd->country);
-	if (gmsd->cross_road) gmsd->cross_road = cet_convert_string(gmsd->cross_road);
-	if (gmsd->facility) gmsd->facility = cet_convert_string(gmsd->facility);
-	if (gmsd->phone_nr) gmsd->phone_nr = cet_convert_string(gmsd->phone_nr);
-	if (gmsd->phone_nr2) gmsd->phone_nr2 = cet_convert_string(gmsd->phone_nr2);
-	if (gmsd->fax_nr) gmsd->fax_nr = cet_convert_string(gmsd->fax_nr);
-	if (gmsd->email) gmsd->email = cet_convert_string(gmsd->email);
-	if (gmsd->postal_code) gmsd->postal_code = cet_convert_string(gmsd->postal_code);
-	if (gmsd->state) gmsd->state = cet_convert_string(gmsd->state);
+	cet_convert_field(&gmsd->addr);
+	cet_convert_field(&gmsd->cc);
+	cet_convert_field(&gmsd->city);
+	cet_convert_field(&gmsd->country);
+	cet_convert_field(&gmsd->cross_road);
+	cet_convert_field(&gmsd->facility);
+	cet_convert_field(&gmsd->phone_nr);
+	cet_convert_field(&gmsd->phone_nr2);
+	cet_convert_field(&gmsd->fax_nr);
+	cet_convert_field(&gmsd->email);
+	cet_convert_field(&gmsd->postal_code);
+	cet_convert_field(&gmsd->state);
 }
 
 /* GPX - out */
@@ -463,7 +463,7 @@ read_tag(const char *caller, const int tag, waypoint *wpt)
 					if (units == 's') speed = MPS_TO_MPH(speed);
 					else speed = MPS_TO_KPH(speed);
 					xasprintf(&str, "%s@%.f", wpt->shortname ? wpt->shortname : "WPT", speed);
-					if (wpt->shortname) xfree(wpt->shortname);
+					if (wpt->shortname) strpool_release(wpt->shortname);
 					wpt->shortname = str;
 				}
 			}
@@ -1023,7 +1023,7 @@ enum_waypt_cb(const waypoint *ref)
 
 	if (*opt_unique == '1') {
 		str = mkshort(short_h, wpt->shortname);
-		xfree(wpt->shortname);
+		strpool_release(wpt->shortname);
 		wpt->shortname = str;
 	}
 
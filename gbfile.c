@@ -22,6 +22,7 @@
 
 #include "defs.h"
 #include "gbfile.h"
+#include "gbnum.h"
 
 #include <assert.h>
 #include <ctype.h>
@@ -29,6 +30,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#if HAVE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
 
 #if __WIN32__
 /* taken from minigzip.c (part of the zlib project) */
@@ -36,6 +42,7 @@
 #  include <io.h>
 #  define SET_BINARY_MODE(file) _setmode(fileno(file), O_BINARY)
 #else
+#  include <unistd.h>
 #  define SET_BINARY_MODE(file)
 #endif
 
@@ -455,6 +462,211 @@ memapi_error(gbfile *self)
 }
 
 
+/*******************************************************************************/
+/* %%%                         Read-ahead buffer                           %%% */
+/*******************************************************************************/
+
+/*
+ * All reads go through a block buffer in front of fileread, so that
+ * gbfgetc and the line readers don't pay for a call into stdio or zlib
+ * per byte.  Reads of at least RBUF_DIRECT bytes bypass an empty buffer.
+ */
+
+#define RBUF_SIZE 65536
+#define RBUF_DIRECT (RBUF_SIZE / 4)
+
+/*
+ * gbfbuffer: move the unread bytes to the front of the read buffer
+ *            and read more behind them, growing the buffer if it is full.
+ *            Returns the number of bytes added.
+ */
+
+static gbsize_t
+gbfbuffer(gbfile *file)
+{
+	gbsize_t count;
+
+	if (file->mapapi) return 0;
+
+	if (file->rpos) {
+		file->rlen -= file->rpos;
+		memmove(file->rbuf, file->rbuf + file->rpos, file->rlen);
+		file->rpos = 0;
+	}
+	if (file->rlen == file->rbufsz) {
+		file->rbufsz = file->rbufsz ? file->rbufsz * 2 : RBUF_SIZE;
+		/* one spare byte to terminate a line at the end of the data */
+		file->rbuf = xrealloc(file->rbuf, file->rbufsz + 1);
+	}
+	count = file->fileread(file->rbuf + file->rlen, 1, file->rbufsz - file->rlen, file);
+	file->rlen += count;
+
+	return count;
+}
+
+/*
+ * gbfunbuffer: drop the read buffer, leaving the stream at the first
+ *              unread byte
+ */
+
+static void
+gbfunbuffer(gbfile *file)
+{
+	if (file->rpos < file->rlen)
+		file->fileseek(file, -(gbint32)(file->rlen - file->rpos), SEEK_CUR);
+	file->rpos = file->rlen = 0;
+}
+
+/*
+ * Output is collected in a write buffer, so that zlib gets whole blocks
+ * to deflate and stdio passes few large writes on to the file or pipe,
+ * instead of handling every single gbfprintf fragment.  Writes of at
+ * least WBUF_SIZE bytes go through once the buffer is drained.
+ */
+
+#define WBUF_SIZE 65536
+
+/*
+ * gbfdrain: pass the buffered output on to filewrite
+ */
+
+static void
+gbfdrain(gbfile *file)
+{
+	gbsize_t len = file->wlen;
+
+	if (len == 0) return;
+
+	file->wlen = 0;
+	if (file->filewrite(file->wbuf, 1, len, file) != len) {
+		fatal("%s: Could not write %lld bytes to %s!\n",
+			file->module, (long long int) len, file->name);
+	}
+}
+
+
+#if HAVE_MMAP
+
+/*******************************************************************************/
+/* %%%                  Memory mapped input files (mapapi)                 %%% */
+/*******************************************************************************/
+
+/*
+ * Regular, uncompressed input files are mapped into memory.  The mapping
+ * is used as the read buffer, so the reads in gbfile are served from it
+ * directly and gbfseek only moves the read position within it.
+ */
+
+static int
+mapapi_map(gbfile *self)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(self->name, O_RDONLY);
+	if (fd == -1) return 0;
+
+	if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) ||
+	    (st.st_size == 0) || (st.st_size > 0x7FFFFFFF)) {
+		close(fd);
+		return 0;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return 0;
+#ifdef MADV_SEQUENTIAL
+	/* most readers go front to back; let the kernel read ahead */
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+#if !ZLIB_INHIBITED
+	/* leave gzip compressed data to zlib */
+	if ((st.st_size >= 2) && (((unsigned char *)map)[0] == 0x1F) &&
+	    (((unsigned char *)map)[1] == 0x8B)) {
+		munmap(map, st.st_size);
+		return 0;
+	}
+#endif
+	self->handle.mem = map;
+	self->memlen = st.st_size;
+	return 1;
+}
+
+static gbfile *
+mapapi_open(gbfile *self, const char *mode)
+{
+	self->rbuf = self->handle.mem;
+	self->rbufsz = self->rlen = self->memlen;
+	self->rpos = 0;
+
+	return self;
+}
+
+static int
+mapapi_close(gbfile *self)
+{
+	self->rbuf = NULL;
+	self->rpos = self->rlen = 0;
+
+	return munmap(self->handle.mem, self->memlen);
+}
+
+static int
+mapapi_seek(gbfile *self, gbint32 offset, int whence)
+{
+	long long pos = self->rpos;
+
+	switch (whence) {
+		case SEEK_CUR: pos = pos + offset; break;
+		case SEEK_END: pos = (long long)self->memlen + offset; break;
+		case SEEK_SET: pos = offset; break;
+	}
+	if (pos < 0)
+		fatal("%s: Unable to set file (%s) to position (%lld)!\n",
+			self->module, self->name, pos);
+	/* a read beyond the end gives EOF, as it would with stdio */
+	self->rpos = (pos > self->memlen) ? self->memlen : pos;
+
+	return 0;
+}
+
+static gbsize_t
+mapapi_read(void *buf, const gbsize_t size, const gbsize_t members, gbfile *self)
+{
+	return 0;	/* all of the file is in the read buffer */
+}
+
+static gbsize_t
+mapapi_write(const void *buf, const gbsize_t size, const gbsize_t members, gbfile *self)
+{
+	return 0;
+}
+
+static gbsize_t
+mapapi_tell(gbfile *self)
+{
+	return self->memlen;	/* gbftell subtracts the unread bytes */
+}
+
+static int
+mapapi_eof(gbfile *self)
+{
+	return 1;
+}
+
+static int
+mapapi_ungetc(const int c, gbfile *self)
+{
+	if ((self->rpos == 0) || (self->rbuf[self->rpos - 1] != (unsigned char)c))
+		fatal(MYNAME ": Cannot store a different byte back into a mapped file!\n");
+	self->rpos--;
+	return c;
+}
+
+#endif	// #if HAVE_MMAP
+
+
 /* GPSBabel 'file' standard calls */
 
 /*
@@ -520,8 +732,30 @@ gbfopen(const char *filename, const char *mode, const char *module)
 			fatal(NO_ZLIB);
 #endif
 		}
+#if HAVE_MMAP
+		/* append and update modes ("a", "r+") also write to the file */
+		else if ((file->mode == 'r') && ! file->is_pipe && (strpbrk(mode, "a+") == NULL))
+			file->mapapi = mapapi_map(file);
+#endif
 
-		if (file->gzapi) {
+		if (file->mapapi) {
+#if HAVE_MMAP
+			file->gzapi = 0;
+
+			file->fileclearerr = memapi_clearerr;
+			file->fileclose = mapapi_close;
+			file->fileeof = mapapi_eof;
+			file->fileerror = memapi_error;
+			file->fileflush = memapi_flush;
+			file->fileopen = mapapi_open;
+			file->fileread = mapapi_read;
+			file->fileseek = mapapi_seek;
+			file->filetell = mapapi_tell;
+			file->fileungetc = mapapi_ungetc;
+			file->filewrite = mapapi_write;
+#endif
+		}
+		else if (file->gzapi) {
 #if !ZLIB_INHIBITED
 
 			file->fileclearerr = gzapi_clearerr;
@@ -557,6 +791,13 @@ gbfopen(const char *filename, const char *mode, const char *module)
 
 	file->fileopen(file, mode);
 
+	/* ports opened for update ("w+") and terminals see every write */
+	if ((file->mode == 'w') && ! file->memapi && (strchr(mode, '+') == NULL) &&
+	    (file->gzapi || ! isatty(fileno(file->handle.std)))) {
+		file->wbufsz = WBUF_SIZE;
+		file->wbuf = xmalloc(file->wbufsz);
+	}
+
 #ifdef DEBUG_MEM
 	file->buffsz = 1;
 #else
@@ -591,8 +832,11 @@ gbfclose(gbfile *file)
 {
 	if (!file) return;
 
+	if (file->wbuf) gbfdrain(file);
 	file->fileclose(file);
 
+	if (file->rbuf) xfree(file->rbuf);
+	if (file->wbuf) xfree(file->wbuf);
 	xfree(file->name);
 	xfree(file->module);
 	xfree(file->buff);
@@ -606,15 +850,11 @@ gbfclose(gbfile *file)
 int
 gbfgetc(gbfile *file)
 {
-	unsigned char c;
-
-	/* errors are caught in gbfread */
-	if (gbfread(&c, 1, 1, file) == 0) {
+	/* errors are caught in fileread */
+	if ((file->rpos == file->rlen) && (gbfbuffer(file) == 0)) {
 		return EOF;
 	}
-	else {
-		return (unsigned int)c;
-	}
+	return file->rbuf[file->rpos++];
 }
 
 /*
@@ -653,8 +893,78 @@ gbfgets(char *buf, int len, gbfile *file)
 gbsize_t
 gbfread(void *buf, const gbsize_t size, const gbsize_t members, gbfile *file)
 {
+	gbsize_t count, result = 0;
+
 	if ((size == 0) || (members == 0)) return 0;
-	return file->fileread(buf, size, members, file);
+
+	count = size * members;
+	if ((file->rpos == file->rlen) && (count >= RBUF_DIRECT))
+		return file->fileread(buf, size, members, file);
+
+	while (result < count) {
+		gbsize_t n = file->rlen - file->rpos;
+
+		if (n == 0) {
+			if (count - result >= RBUF_DIRECT) {
+				result += file->fileread((char *)buf + result, 1, count - result, file);
+				break;
+			}
+			if (gbfbuffer(file) == 0) break;
+			continue;
+		}
+		if (n > count - result) n = count - result;
+		memcpy((char *)buf + result, file->rbuf + file->rpos, n);
+		file->rpos += n;
+		result += n;
+	}
+
+	/* as gzapi_read does for an incomplete single record */
+	if (file->gzapi && (members == 1) && (size > 1) && (result > 0) && (result < size))
+		fatal("%s: Unexpected end of file (EOF)!\n", file->module);
+
+	return result / size;
+}
+
+/*
+ * gbfreadptr: Reads count bytes and returns a pointer to them, or NULL without
+ *             reading anything if there are fewer left.  The bytes stay valid
+ *             until the next read, seek or close.  They are not copied if the
+ *             file is mapped into memory.
+ */
+
+const void *
+gbfreadptr(gbfile *file, const gbsize_t count)
+{
+	const void *result;
+
+	while (file->rlen - file->rpos < count) {
+		if (gbfbuffer(file) == 0) return NULL;
+	}
+	result = file->rbuf + file->rpos;
+	file->rpos += count;
+
+	return result;
+}
+
+/*
+ * gbfpeekptr: Returns a pointer to the next unread bytes without reading
+ *             them.  *count is the number wanted on entry and the number
+ *             available on return, which is less only at the end of the
+ *             file.  The bytes stay valid until the next read, seek or
+ *             close; gbfreadptr(file, *count) then consumes them in place.
+ */
+
+const void *
+gbfpeekptr(gbfile *file, gbsize_t *count)
+{
+	while (file->rlen - file->rpos < *count) {
+		if (gbfbuffer(file) == 0) {
+			*count = file->rlen - file->rpos;
+			break;
+		}
+	}
+
+	return file->rbuf + file->rpos;
 }
 
 /*
@@ -669,7 +979,7 @@ int gbvfprintf(gbfile *file, const char *format, va_list ap)
 		va_list args;
 
 		va_copy(args, ap);
-		len = vsnprintf(file->buff, file->buffsz, format, args);
+		len = gb_vsnprintf(file->buff, file->buffsz, format, args);
 		va_end(args);
 
 		/* Unambiguous Success */
@@ -747,6 +1057,17 @@ gbfwrite(const void *buf, const gbsize_t size, const gbsize_t members, gbfile *f
 {
 	int result;
 
+	if (file->rlen && ! file->mapapi) gbfunbuffer(file);
+	if (file->wbuf) {
+		gbsize_t count = size * members;
+
+		if (file->wlen + count > file->wbufsz) gbfdrain(file);
+		if (count < file->wbufsz) {
+			memcpy(file->wbuf + file->wlen, buf, count);
+			file->wlen += count;
+			return members;
+		}
+	}
 	result = file->filewrite(buf, size, members, file);
 	if (result != members) {
 		fatal("%s: Could not write %lld bytes to %s (result %d)!\n",
@@ -766,6 +1087,7 @@ gbfwrite(const void *buf, const gbsize_t size, const gbsize_t members, gbfile *f
 int
 gbfflush(gbfile *file)
 {
+	if (file->wbuf) gbfdrain(file);
 	return file->fileflush(file);
 }
 
@@ -807,6 +1129,22 @@ gbfrewind(gbfile *file)
 int
 gbfseek(gbfile *file, gbint32 offset, int whence)
 {
+	if (file->mapapi) return file->fileseek(file, offset, whence);
+	if (file->wbuf) gbfdrain(file);
+
+	if (file->rlen) {
+		gbsize_t unread = file->rlen - file->rpos;
+
+		if (whence == SEEK_CUR) {
+			/* stay in the read buffer if we can */
+			if ((offset >= -(gbint32)file->rpos) && (offset <= (gbint32)unread)) {
+				file->rpos += offset;
+				return 0;
+			}
+			offset -= unread;
+		}
+		file->rpos = file->rlen = 0;
+	}
 	return file->fileseek(file, offset, whence);
 }
 
@@ -821,7 +1159,7 @@ gbftell(gbfile *file)
 	if ((signed) result == -1)
 		fatal("%s: Could not determine position of file '%s'!\n",
 			file->module, file->name);
-	return result;
+	return result - (file->rlen - file->rpos) + file->wlen;
 }
 
 /*
@@ -831,6 +1169,7 @@ gbftell(gbfile *file)
 int
 gbfeof(gbfile *file)
 {
+	if (file->rpos < file->rlen) return 0;
 	return file->fileeof(file);
 }
 
@@ -841,7 +1180,21 @@ gbfeof(gbfile *file)
 int
 gbfungetc(const int c, gbfile *file)
 {
-	return file->fileungetc(c, file);
+	if (c == EOF) return EOF;
+	if (file->mapapi) return file->fileungetc(c, file);
+
+	if (file->rpos == 0) {
+		if (file->rlen == file->rbufsz) {
+			file->rbufsz = file->rbufsz ? file->rbufsz * 2 : RBUF_SIZE;
+			file->rbuf = xrealloc(file->rbuf, file->rbufsz + 1);
+		}
+		memmove(file->rbuf + 1, file->rbuf, file->rlen);
+		file->rpos = 1;
+		file->rlen++;
+	}
+	file->rbuf[--file->rpos] = (unsigned char)c;
+
+	return c;
 }
 
 /* GPSBabel 'file' enhancements */
@@ -930,7 +1283,7 @@ gbfgetcstr(gbfile *file)
 		if ((c == 0) || (c == EOF)) break;
 
 		if (len == file->buffsz) {
-			file->buffsz += 64;
+			file->buffsz *= 2;
 			str = file->buff = xrealloc(file->buff, file->buffsz + 1);
 		}
 		str[len] = c;
@@ -966,120 +1319,205 @@ gbfgetpstr(gbfile *file)
 	return result;
 }
 
+/*
+ * gbfgetucs2str: Reads a line of UCS-2 text, which ends with CR/LF, and
+ *                returns it converted to UTF-8.  Everything up to the next
+ *                CR in the read buffer is converted in one go.
+ */
+
 static char *
 gbfgetucs2str(gbfile *file)
 {
-	int len = 0;
-	char *result = file->buff;
+	int lo = file->big_endian ? 1 : 0;	/* offset of the low byte */
+	gbsize_t len = 0;
+	char *result;
 
 	for (;;) {
-		char buff[8];
-		int clen;
-		int c0, c1;
-		
-		c0 = gbfgetc(file);
-		if ((c0 == EOF) && (len == 0)) return NULL;
-		c1 = gbfgetc(file);
-		if ((c1 == EOF) && (len == 0)) return NULL;
-
-		if (file->big_endian) c0 = c1 | (c0 << 8);
-		else c0 = c0 | (c1 << 8);
+		unsigned char *p = file->rbuf + file->rpos;
+		gbsize_t n = (file->rlen - file->rpos) & ~1;	/* whole characters */
+		unsigned char *e = p;
+		gbsize_t count;
+
+		/* a CR is a '\r' low byte of a character with a zero high byte */
+		while ((e = memchr(e, '\r', p + n - e))) {
+			if ((((e - p) & 1) == lo) && (e[lo ? -1 : 1] == 0)) break;
+			e++;
+		}
 
-		if (c0 == '\r') {
+		count = ((e ? e - lo : p + n) - p) / 2;
+		if (len + 3 * count >= file->buffsz) {
+			while (len + 3 * count >= file->buffsz)
+				file->buffsz *= 2;
+			file->buff = xrealloc(file->buff, file->buffsz + 1);
+		}
+		len += cet_ucs2_to_utf8(file->buff + len, p, count, file->big_endian);
+		file->rpos += 2 * count;
 
-			c0 = gbfgetc(file);
-			if ((c0 == EOF) && (len == 0)) return NULL;
-			c1 = gbfgetc(file);
-			if ((c1 == EOF) && (len == 0)) return NULL;
+		if (e) {
+			int c;
 
-			if (file->big_endian) c0 = c1 | (c0 << 8);
-			else c0 = c0 | (c1 << 8);
+			file->rpos += 2;
+			while ((file->rlen - file->rpos < 2) && gbfbuffer(file)) ;
+			if (file->rlen - file->rpos < 2) {
+				if (len == 0) return NULL;
+				c = EOF;
+			}
+			else c = file->rbuf[file->rpos + lo] | (file->rbuf[file->rpos + (lo ^ 1)] << 8);
 
-			if (c0 != '\n')
+			if (c != '\n')
 				fatal("%s: Invalid unicode (UCS-2/%s endian) line break!\n",
 					file->module,
 					file->big_endian ? "Big" : "Little");
+			file->rpos += 2;
 			break;
 		}
-
-		clen = cet_ucs4_to_utf8(buff, sizeof(buff), c0);
-
-		if (len+clen >= file->buffsz) {
-			file->buffsz += 64;
-			result = file->buff = xrealloc(file->buff, file->buffsz + 1);
+		/* no CR in the buffer: read more, or take the rest as the last line */
+		if (gbfbuffer(file) == 0) {
+			if (len == 0) return NULL;
+			break;
 		}
-		memcpy(&result[len], buff, clen);
-		len += clen;
 	}
+	result = file->buff;
 	result[len] = '\0';	// terminate resulting string
 
 	return result;
 }
 
 /*
- * gbfgetstr: Reads a string from file (util any type of line-breaks or eof or error)
- *            except xfree and free you can do all possible things with the result
+ * gbffindline: Finds the end of the next line in the read buffer, reading
+ *              more as needed.  The line starts at rbuf[rpos]; its length
+ *              goes to *len and the character that ended it is returned
+ *              (EOF at the end of the file).
  */
 
-char *
-gbfgetstr(gbfile *file)
+static int
+gbffindline(gbfile *file, gbsize_t *len)
 {
-	int len = 0;
-	char *result = file->buff;
-
-	if (file->unicode) return gbfgetucs2str(file);
+	gbsize_t scanned = 0;
 
 	for (;;) {
-		int c = gbfgetc(file);
+		unsigned char *p = file->rbuf + file->rpos + scanned;
+		gbsize_t n = file->rlen - file->rpos - scanned;
 
-		if ((c == EOF) || (c == 0x1A)) {
-			if (len == 0) {
-				return NULL;
+		if (n > 0) {
+			unsigned char *e, *e2;
+			gbsize_t lim;
+
+			e = memchr(p, '\n', n);
+			lim = e ? e - p : n;
+			if ((e2 = memchr(p, '\r', lim))) {
+				e = e2;
+				lim = e2 - p;
 			}
-			break;
-		}
-		else if (c == '\r') {
-			c = gbfgetc(file);
-			if ((c != '\n') && (c != EOF))
-				gbfungetc(c, file);
-			break;
+			if ((e2 = memchr(p, 0x1A, lim))) {
+				e = e2;
+				lim = e2 - p;
+			}
+			/* a CR at the end of the data may be followed by a LF */
+			if (e && ((*e != '\r') || (lim + 1 < n))) {
+				*len = scanned + lim;
+				return *e;
+			}
+			scanned += lim;
 		}
-		else if (c == '\n') {
-			break;
+		if (gbfbuffer(file) == 0) {
+			*len = scanned;
+			if (scanned < file->rlen - file->rpos)
+				return '\r';
+			return EOF;
 		}
-		else if (((c == 0xFE) || (c == 0xFF)) && (! file->unicode_checked)) {
-			int cx;
-			int c1 = gbfgetc(file);
-			if (c1 != EOF) {
-				cx = c | (c1 << 8);
-				if (cx == 0xFEFF) {
-					file->unicode = 1;
-					file->big_endian = 0;
-					return gbfgetucs2str(file);
-				}
-				else if (cx == 0xFFFE) {
+	}
+}
+
+/*
+ * gbfgetline: Reads a string from file (util any type of line-breaks or eof or error)
+ *             The result points into the read buffer of the file: you can change
+ *             it, but it is only valid until the next read, seek or close.
+ */
+
+char *
+gbfgetline(gbfile *file)
+{
+	gbsize_t len;
+	char *result;
+	int c;
+
+	if (file->unicode) return gbfgetucs2str(file);
+
+	if (! file->unicode_checked) {
+		if ((file->rpos == file->rlen) && (gbfbuffer(file) == 0))
+			return NULL;
+		c = file->rbuf[file->rpos];
+		if ((c == 0xFE) || (c == 0xFF)) {
+			if (file->rlen - file->rpos < 2) gbfbuffer(file);
+			if (file->rlen - file->rpos >= 2) {
+				int cx = c | (file->rbuf[file->rpos + 1] << 8);
+				if ((cx == 0xFEFF) || (cx == 0xFFFE)) {
+					file->rpos += 2;
 					file->unicode = 1;
-					file->big_endian = 1;
+					file->big_endian = (cx == 0xFFFE);
 					return gbfgetucs2str(file);
 				}
-				else gbfungetc(c1, file);
 			}
 		}
+		/* only the first character of the file is checked */
+		if ((c != '\r') && (c != '\n') && (c != 0x1A))
+			file->unicode_checked = 1;
+	}
 
-		file->unicode_checked = 1;
+	c = gbffindline(file, &len);
+	if ((len == 0) && ((c == EOF) || (c == 0x1A))) {
+		if (c == 0x1A) file->rpos++;
+		return NULL;
+	}
 
-		if (len == file->buffsz) {
-			file->buffsz += 64;
-			result = file->buff = xrealloc(file->buff, file->buffsz + 1);
+	result = (char *)file->rbuf + file->rpos;
+	file->rpos += len;
+	if (c != EOF) {
+		file->rpos++;
+		if ((c == '\r') && (file->rpos < file->rlen) && (file->rbuf[file->rpos] == '\n'))
+			file->rpos++;
+	}
+	if (file->mapapi) {	/* the mapping is read-only */
+		if (len >= file->buffsz) {
+			while (len >= file->buffsz)
+				file->buffsz *= 2;
+			xfree(file->buff);
+			file->buff = xmalloc(file->buffsz);
 		}
-		result[len] = (char)c;
-		len++;
+		memcpy(file->buff, result, len);
+		result = file->buff;
 	}
 	result[len] = '\0';	// terminate resulting string
 
 	return result;
 }
 
+/*
+ * gbfgetstr: Reads a string from file (util any type of line-breaks or eof or error)
+ *            except xfree and free you can do all possible things with the result
+ */
+
+char *
+gbfgetstr(gbfile *file)
+{
+	char *line = gbfgetline(file);
+	int len;
+
+	if ((line == NULL) || (line == file->buff)) return line;
+
+	len = strlen(line);
+	if (len >= file->buffsz) {
+		while (len >= file->buffsz)
+			file->buffsz *= 2;
+		xfree(file->buff);
+		file->buff = xmalloc(file->buffsz);
+	}
+	memcpy(file->buff, line, len + 1);
+
+	return file->buff;
+}
+
 /*
  * gbfputint16: write a signed 16-bit integer value into output stream
  */
@@ -60,6 +60,13 @@ typedef struct gbfile_s {
 	char   *module;
 	char   *buff;	/* static growing buffer, primary used by gbprintf */
 	int    buffsz;
+	unsigned char *rbuf;	/* read-ahead buffer in front of fileread */
+	gbsize_t rbufsz;
+	gbsize_t rpos;		/* next unread byte in rbuf */
+	gbsize_t rlen;		/* number of valid bytes in rbuf */
+	unsigned char *wbuf;	/* output collected in front of filewrite */
+	gbsize_t wbufsz;
+	gbsize_t wlen;		/* number of pending bytes in wbuf */
 	char   mode;
 	int    back;
 	gbsize_t mempos;	/* curr. position in memory */
@@ -69,6 +76,7 @@ typedef struct gbfile_s {
 	unsigned char binary:1;
 	unsigned char gzapi:1;
 	unsigned char memapi:1;
+	unsigned char mapapi:1;
 	unsigned char unicode:1;
 	unsigned char unicode_checked:1;
 	unsigned char is_pipe:1;
@@ -92,6 +100,8 @@ gbfile *gbfopen_be(const char *filename, const char *mode, const char *module);
 void gbfclose(gbfile *file);
 
 gbsize_t gbfread(void *buf, const gbsize_t size, const gbsize_t members, gbfile *file);
+const void *gbfreadptr(gbfile *file, const gbsize_t count);
+const void *gbfpeekptr(gbfile *file, gbsize_t *count);
 int gbfgetc(gbfile *file);
 char *gbfgets(char *buf, int len, gbfile *file);
 
@@ -117,6 +127,7 @@ gbint16 gbfgetint16(gbfile *file);
 double gbfgetdbl(gbfile *file);			// read a double value
 float gbfgetflt(gbfile *file);			// read a float value
 char *gbfgetstr(gbfile *file);			// read until any type of line-breaks or EOF
+char *gbfgetline(gbfile *file);			// as gbfgetstr, but without a copy of the line
 char *gbfgetpstr(gbfile *file);			// read a pascal string
 char *gbfgetcstr(gbfile *file);			// read a null terminated string
 
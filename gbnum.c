@@ -0,0 +1,510 @@
+/*
+
+    Fast number formatting and parsing.
+    Copyright (C) 2009  Tom Payne, twpayne@gmail.com
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+
+#include "defs.h"
+#include "gbnum.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IS_DIGIT(c) ((unsigned) ((c) - '0') < 10)
+
+static const unsigned long pow5[] = {
+	1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125
+};
+
+static const unsigned long long pow10[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+/* every power of ten up to 1e22 is exactly representable as a double */
+static const double pow10d[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Write the decimal digits of n to buf and return their number. */
+static int
+fmt_digits(char *buf, unsigned long long n)
+{
+	char tmp[20];
+	int len = 0, i;
+
+	do {
+		tmp[len++] = '0' + (int) (n % 10);
+		n /= 10;
+	} while (n);
+	for (i = 0; i < len; i++)
+		buf[i] = tmp[len - 1 - i];
+	return len;
+}
+
+static int
+fmt_hex(char *buf, unsigned long long n, int upper)
+{
+	const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	char tmp[16];
+	int len = 0, i;
+
+	do {
+		tmp[len++] = digits[n & 15];
+		n >>= 4;
+	} while (n);
+	for (i = 0; i < len; i++)
+		buf[i] = tmp[len - 1 - i];
+	return len;
+}
+
+/*
+ * gb_fmt_fixed: as sprintf(buf, "%.*f", prec, d), rounding the exact
+ * binary value to nearest, ties to even, as the C library does.  Only
+ * handles 0 <= prec <= 9 and |d| < 2^31, which covers coordinates,
+ * altitudes and the like.  Returns the length, or -1 without writing
+ * anything for other values.
+ */
+
+int
+gb_fmt_fixed(char *buf, double d, int prec)
+{
+	unsigned long long bits, m, lo, hi, q, ip, fp;
+	int exp, shift;
+	char *p = buf;
+
+	if ((prec < 0) || (prec > 9) || (sizeof(d) != sizeof(bits))) return -1;
+
+	memcpy(&bits, &d, sizeof(bits));
+	exp = (int) ((bits >> 52) & 0x7FF);
+	if (exp >= 1023 + 31) return -1;	/* too large, infinite or NaN */
+
+	m = bits & 0xFFFFFFFFFFFFFULL;
+	if (exp) m |= 1ULL << 52;
+	else exp = 1;				/* denormal */
+
+	/* d * 10^prec == m * 5^prec * 2^shift, with m * 5^prec < 2^74 in hi:lo */
+	shift = exp - 1075 + prec;
+	lo = (m & 0xFFFFFFFF) * pow5[prec];
+	hi = (m >> 32) * pow5[prec];
+	q = lo + (hi << 32);
+	hi = (hi >> 32) + (q < lo);
+	lo = q;
+
+	if (shift >= 0) {
+		q = lo << shift;		/* hi is 0, as the result < 2^61 */
+	}
+	else if (shift <= -75) {
+		q = 0;				/* less than half a unit */
+	}
+	else {
+		int k = -shift, r = k - 1;
+		int round, sticky;
+
+		if (k >= 64) q = hi >> (k - 64);
+		else q = (lo >> k) | (hi << (64 - k));
+
+		if (r >= 64) {
+			round = (hi >> (r - 64)) & 1;
+			sticky = (lo != 0) || ((hi & ((1ULL << (r - 64)) - 1)) != 0);
+		}
+		else {
+			round = (lo >> r) & 1;
+			sticky = (lo & ((1ULL << r) - 1)) != 0;
+		}
+		if (round && (sticky || (q & 1))) q++;
+	}
+
+	if (bits >> 63) *p++ = '-';
+	ip = q / pow10[prec];
+	fp = q % pow10[prec];
+	p += fmt_digits(p, ip);
+	if (prec) {
+		int i;
+
+		*p++ = '.';
+		for (i = prec - 1; i >= 0; i--) {
+			p[i] = '0' + (int) (fp % 10);
+			fp /= 10;
+		}
+		p += prec;
+	}
+	*p = '\0';
+
+	return p - buf;
+}
+
+/*
+ * The formatter behind gb_vsnprintf.  It knows the flags '-' and '0',
+ * widths and precisions (also as '*'), the length modifiers h, l and ll
+ * and the conversions d, i, u, x, X, c, s, f, F and %.  Anything else
+ * makes it give up, and the whole format goes to vsnprintf instead.
+ */
+
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t len;
+} gb_out_t;
+
+static void
+out_put(gb_out_t *out, const char *s, size_t n)
+{
+	if (out->len < out->size) {
+		size_t room = out->size - out->len;
+		memcpy(out->buf + out->len, s, (n < room) ? n : room);
+	}
+	out->len += n;
+}
+
+static void
+out_fill(gb_out_t *out, char c, int n)
+{
+	while (n-- > 0) {
+		if (out->len < out->size) out->buf[out->len] = c;
+		out->len++;
+	}
+}
+
+/* body of n bytes with a sign or prefix of pre bytes, padded to width */
+static void
+out_field(gb_out_t *out, const char *s, int pre, int n, int width, int left, int zero)
+{
+	int pad = width - n;
+
+	if (left) {
+		out_put(out, s, n);
+		out_fill(out, ' ', pad);
+	}
+	else if (zero) {
+		out_put(out, s, pre);
+		out_fill(out, '0', pad);
+		out_put(out, s + pre, n - pre);
+	}
+	else {
+		out_fill(out, ' ', pad);
+		out_put(out, s, n);
+	}
+}
+
+static int
+gb_vformat(gb_out_t *out, const char *fmt, va_list ap)
+{
+	const char *f = fmt;
+
+	while (*f) {
+		const char *pct = strchr(f, '%');
+		int left = 0, zero = 0, width = 0, prec = -1, lng = 0;
+		char tmp[48];
+		int n;
+
+		if (pct == NULL) {
+			out_put(out, f, strlen(f));
+			break;
+		}
+		out_put(out, f, pct - f);
+		f = pct + 1;
+
+		for (;; f++) {
+			if (*f == '-') left = 1;
+			else if (*f == '0') zero = 1;
+			else break;
+		}
+		if (*f == '*') {
+			width = va_arg(ap, int);
+			if (width < 0) {
+				left = 1;
+				width = -width;
+			}
+			f++;
+		}
+		else while (IS_DIGIT(*f)) width = width * 10 + (*f++ - '0');
+		if (*f == '.') {
+			f++;
+			if (*f == '*') {
+				prec = va_arg(ap, int);
+				if (prec < 0) prec = -1;
+				f++;
+			}
+			else for (prec = 0; IS_DIGIT(*f); f++) prec = prec * 10 + (*f - '0');
+		}
+		if (*f == 'h') {
+			lng = -1;
+			f++;
+		}
+		else if (*f == 'l') {
+			lng = 1;
+			if (*++f == 'l') {
+				lng = 2;
+				f++;
+			}
+		}
+		if (left) zero = 0;
+
+		switch (*f++) {
+		case 'd':
+		case 'i': {
+			long long v;
+			unsigned long long u;
+			int neg;
+
+			if (lng == 2) v = va_arg(ap, long long);
+			else if (lng == 1) v = va_arg(ap, long);
+			else v = va_arg(ap, int);
+			if (lng < 0) v = (short) v;
+			neg = (v < 0);
+			u = neg ? 0 - (unsigned long long) v : (unsigned long long) v;
+			if (neg) tmp[0] = '-';
+			if ((prec == 0) && (u == 0)) n = 0;
+			else n = fmt_digits(tmp + neg, u);
+			if (prec > 20) return -1;
+			if (prec > n) {
+				memmove(tmp + neg + prec - n, tmp + neg, n);
+				memset(tmp + neg, '0', prec - n);
+				n = prec;
+			}
+			out_field(out, tmp, neg, neg + n, width, left, zero && (prec < 0));
+			break;
+		}
+		case 'u':
+		case 'x':
+		case 'X': {
+			unsigned long long u;
+
+			if (lng == 2) u = va_arg(ap, unsigned long long);
+			else if (lng == 1) u = va_arg(ap, unsigned long);
+			else u = va_arg(ap, unsigned int);
+			if (lng < 0) u = (unsigned short) u;
+			if ((prec == 0) && (u == 0)) n = 0;
+			else if (f[-1] == 'u') n = fmt_digits(tmp, u);
+			else n = fmt_hex(tmp, u, f[-1] == 'X');
+			if (prec > 20) return -1;
+			if (prec > n) {
+				memmove(tmp + prec - n, tmp, n);
+				memset(tmp, '0', prec - n);
+				n = prec;
+			}
+			out_field(out, tmp, 0, n, width, left, zero && (prec < 0));
+			break;
+		}
+		case 'c':
+			if (zero || lng) return -1;
+			tmp[0] = (char) va_arg(ap, int);
+			out_field(out, tmp, 0, 1, width, left, 0);
+			break;
+		case 's': {
+			const char *s;
+
+			if (zero || lng) return -1;
+			s = va_arg(ap, const char *);
+			if (s == NULL) return -1;	/* "(null)" is up to the C library */
+			/* as strnlen; never look past the end of a shorter string */
+			if (prec >= 0) for (n = 0; (n < prec) && s[n]; n++);
+			else n = strlen(s);
+			out_field(out, s, 0, n, width, left, 0);
+			break;
+		}
+		case 'f':
+		case 'F': {
+			double d;
+
+			if (lng < 0) return -1;
+			d = va_arg(ap, double);
+			n = gb_fmt_fixed(tmp, d, (prec < 0) ? 6 : prec);
+			if (n < 0) {
+				/* leave the big, odd or very precise ones to the C library */
+				char spec[32], *buf;
+
+				if (prec > 64) return -1;
+				snprintf(spec, sizeof(spec), "%%%s%s*.*%c",
+					left ? "-" : "", zero ? "0" : "", f[-1]);
+				n = snprintf(NULL, 0, spec, width, (prec < 0) ? 6 : prec, d);
+				if (n < 0) return -1;
+				buf = xmalloc(n + 1);
+				snprintf(buf, n + 1, spec, width, (prec < 0) ? 6 : prec, d);
+				out_put(out, buf, n);
+				xfree(buf);
+				break;
+			}
+			out_field(out, tmp, (tmp[0] == '-'), n, width, left, zero);
+			break;
+		}
+		case '%':
+			if ((f - pct) != 2) return -1;
+			out_put(out, "%", 1);
+			break;
+		default:
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * gb_vsnprintf: (as vsnprintf)
+ */
+
+int
+gb_vsnprintf(char *buf, size_t size, const char *fmt, va_list ap)
+{
+	gb_out_t out;
+	va_list args;
+	int result;
+
+	out.buf = buf;
+	out.size = size;
+	out.len = 0;
+
+	va_copy(args, ap);
+	result = gb_vformat(&out, fmt, args);
+	va_end(args);
+
+	if (result < 0) return vsnprintf(buf, size, fmt, ap);
+
+	if (size) buf[(out.len < size) ? out.len : size - 1] = '\0';
+	return (int) out.len;
+}
+
+/*
+ * gb_snprintf: (as snprintf)
+ */
+
+int
+gb_snprintf(char *buf, size_t size, const char *fmt, ...)
+{
+	va_list args;
+	int result;
+
+	va_start(args, fmt);
+	result = gb_vsnprintf(buf, size, fmt, args);
+	va_end(args);
+
+	return result;
+}
+
+/*
+ * gb_strtod: (as strtod)
+ * Plain decimal numbers with up to 15 significant digits and 22
+ * decimals are one exact integer divided by an exact power of ten,
+ * which rounds exactly as strtod does.  The rest goes to strtod.
+ */
+
+#define MAX_EXACT (1ULL << 53)	/* integers up to here are exact doubles */
+
+double
+gb_strtod(const char *s, char **end)
+{
+	const char *p = s;
+	unsigned long long m = 0;
+	int neg = 0, digits = 0, decimals = 0;
+	double d;
+
+	while (isspace((unsigned char) *p)) p++;
+	if (*p == '-') {
+		neg = 1;
+		p++;
+	}
+	else if (*p == '+') p++;
+
+	for (; IS_DIGIT(*p); p++, digits++) {
+		if (m >= MAX_EXACT) return strtod(s, end);
+		m = m * 10 + (*p - '0');
+	}
+	if (*p == '.') {
+		for (p++; IS_DIGIT(*p); p++, digits++, decimals++) {
+			if (m >= MAX_EXACT) return strtod(s, end);
+			m = m * 10 + (*p - '0');
+		}
+	}
+	if ((digits == 0) || (decimals > 22) || (m > MAX_EXACT) ||
+	    (*p == 'e') || (*p == 'E') || (*p == 'x') || (*p == 'X'))
+		return strtod(s, end);
+
+	if (end) *end = (char *) p;
+	d = (double) m;
+	if (decimals) d /= pow10d[decimals];
+	return neg ? -d : d;
+}
+
+/*
+ * gb_scan_dbl: as a "%lf" conversion of sscanf, reading from *s and
+ *              advancing it.  Returns 1 if a number was read.
+ */
+
+int
+gb_scan_dbl(const char **s, double *d)
+{
+	char *end;
+	double val;
+
+	val = gb_strtod(*s, &end);
+	if (end == *s) return 0;
+	*d = val;
+	*s = end;
+	return 1;
+}
+
+/*
+ * gb_parse_dbl: (as sscanf(s, "%lf", d) == 1)
+ */
+
+int
+gb_parse_dbl(const char *s, double *d)
+{
+	return gb_scan_dbl(&s, d);
+}
+
+/*
+ * gb_scan_uint: reads a field of exactly len decimal digits.
+ *               Returns 1 on success, and 0 if any of them is not a digit.
+ */
+
+int
+gb_scan_uint(const char *s, int len, unsigned int *val)
+{
+	unsigned int v = 0;
+
+	while (len--) {
+		if (! IS_DIGIT(*s)) return 0;
+		v = v * 10 + (*s++ - '0');
+	}
+	*val = v;
+	return 1;
+}
+
+/*
+ * gb_scan_int: as gb_scan_uint, but the field may start with a sign.
+ */
+
+int
+gb_scan_int(const char *s, int len, int *val)
+{
+	unsigned int v;
+	int neg = (*s == '-');
+
+	if ((neg || (*s == '+')) && (len > 1)) {
+		s++;
+		len--;
+	}
+	if (! gb_scan_uint(s, len, &v)) return 0;
+	*val = neg ? -(int) v : (int) v;
+	return 1;
+}
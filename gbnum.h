@@ -0,0 +1,50 @@
+/*
+
+    Fast number formatting and parsing.
+    Copyright (C) 2009  Tom Payne, twpayne@gmail.com
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+
+#ifndef GBNUM_H
+#define GBNUM_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/*
+ * Drop-in replacements for the printf and scanf conversions that the
+ * writers and readers spend most of their time in.  They give exactly
+ * the results of the C library for the common cases (plain decimal
+ * numbers, "%.Nf" with up to nine decimals, integers and strings) and
+ * hand everything else over to it, so output never changes.
+ */
+
+/* room for any string written by gb_fmt_fixed() */
+#define GB_FMT_FIXED_SIZE 32
+
+int gb_fmt_fixed(char *buf, double d, int prec);
+
+int gb_vsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+int gb_snprintf(char *buf, size_t size, const char *fmt, ...);
+
+double gb_strtod(const char *s, char **end);
+int gb_scan_dbl(const char **s, double *d);
+int gb_parse_dbl(const char *s, double *d);
+int gb_scan_uint(const char *s, int len, unsigned int *val);
+int gb_scan_int(const char *s, int len, int *val);
+
+#endif
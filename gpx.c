@@ -23,13 +23,17 @@
 #include "xmlgeneric.h"
 #include "cet_util.h"
 #include "garmin_fs.h"
+#include "gbnum.h"
 #if HAVE_LIBEXPAT
 	#include <expat.h>
 	static XML_Parser psr;
 #endif
 
 static xml_tag *cur_tag;
+static xml_tag *cur_tag_tail;	/* last child of cur_tag */
+static fs_xml *cur_fs_gpx;	/* the tree cur_tag belongs to */
 static vmem_t cdatastr;
+static size_t cdatalen;		/* length of the string in cdatastr */
 static char *opt_logpoint = NULL;
 static char *opt_humminbirdext = NULL;
 static char *opt_garminext = NULL;
@@ -70,7 +74,7 @@ static bounds all_bounds;
 static format_specific_data **fs_ptr;
 
 #define MYNAME "GPX"
-#define MY_CBUF_SZ 4096
+#define MY_CBUF_SZ 65536
 #define DEFAULT_XSI_SCHEMA_LOC "http://www.topografix.com/GPX/1/0 http://www.topografix.com/GPX/1/0/gpx.xsd"
 #define DEFAULT_XSI_SCHEMA_LOC_11 "http://www.topografix.com/GPX/1/1 http://www.topografix.com/GPX/1/1/gpx.xsd"
 #define DEFAULT_XSI_SCHEMA_LOC_FMT "\"http://www.topografix.com/GPX/%c/%c http://www.topografix.com/GPX/%c/%c/gpx.xsd\""
@@ -394,17 +398,38 @@ tag_mapping tag_path_map[] = {
 	{0, 0, NULL, 0UL}
 };
 
+/*
+ * For every open element the length of its path in current_tag, the CRC
+ * of that path and the tag it maps to.  An element's CRC extends the one
+ * of its parent and the end handler takes the tag found at the start, so
+ * the path is hashed only once and only its last part.
+ */
+typedef struct {
+	size_t len;
+	unsigned long crc;
+	tag_type tag;
+	int passthrough;
+} tag_level;
+static tag_level *tag_stack;
+static int tag_depth;
+static int tag_stack_sz;
+
+/*
+ * tag_path_map is hashed by the CRC of the paths into a table that is
+ * made large enough for no two paths to share a slot, so every lookup
+ * is a single probe.
+ */
+static tag_mapping **tag_hash;
+static unsigned long tag_hash_mask;
+
 static tag_type
-get_tag(const char *t, int *passthrough)
+get_tag(const char *t, unsigned long crc, int *passthrough)
 {
-	tag_mapping *tm;
-	unsigned long tcrc = get_crc32_s(t);
+	tag_mapping *tm = tag_hash[crc & tag_hash_mask];
 
-	for (tm = tag_path_map; tm->tag_type != 0; tm++) {
-		if ((tcrc == tm->crc) && (0 == strcmp(tm->tag_name, t))) {
-			*passthrough = tm->tag_passthrough;
-			return tm->tag_type;
-		}
+	if (tm && (0 == strcmp(tm->tag_name, t))) {
+		*passthrough = tm->tag_passthrough;
+		return tm->tag_type;
 	}
 	*passthrough = 1;
 	return tt_unknown;
@@ -414,9 +439,28 @@ static void
 prescan_tags(void)
 {
 	tag_mapping *tm;
+	unsigned long size;
+
 	for (tm = tag_path_map; tm->tag_type != 0; tm++) {
 		tm->crc = get_crc32_s(tm->tag_name);
 	}
+	for (size = 256; ; size *= 2) {
+		tag_hash = xcalloc(size, sizeof(*tag_hash));
+		for (tm = tag_path_map; tm->tag_type != 0; tm++) {
+			tag_mapping **slot = &tag_hash[tm->crc & (size - 1)];
+
+			if (*slot == NULL) {
+				*slot = tm;
+			}
+			/* a repeated path keeps its first entry, two paths mean a retry */
+			else if (strcmp((*slot)->tag_name, tm->tag_name)) {
+				break;
+			}
+		}
+		if (tm->tag_type == 0) break;
+		xfree(tag_hash);
+	}
+	tag_hash_mask = size - 1;
 }
 
 static void
@@ -458,15 +502,13 @@ tag_wpt(const char **attrv)
 
 	wpt_tmp = waypt_new();
 
-	cur_tag = NULL;
+	cur_tag = cur_tag_tail = NULL;
 	while (*avp) { 
 		if (strcmp(avp[0], "lat") == 0) {
-			sscanf(avp[1], "%lf", 
-				&wpt_tmp->latitude);
+			gb_parse_dbl(avp[1], &wpt_tmp->latitude);
 		}
 		else if (strcmp(avp[0], "lon") == 0) {
-			sscanf(avp[1], "%lf", 
-				&wpt_tmp->longitude);
+			gb_parse_dbl(avp[1], &wpt_tmp->longitude);
 		}
 		avp+=2;
 	}
@@ -527,9 +569,22 @@ start_something_else(const char *el, const char **attrv)
 	if ( !fs_ptr ) {
 		return;
 	}
+
+	/* find the tree first: the tag is allocated from it */
+	if ( cur_tag ) {
+		fs_gpx = cur_fs_gpx;
+	}
+	else {
+		fs_gpx = (fs_xml *)fs_chain_find( *fs_ptr, FS_GPX );
+		if ( !fs_gpx || !fs_gpx->tag ) {
+			fs_gpx = fs_xml_alloc(FS_GPX);
+			fs_chain_add( fs_ptr, (format_specific_data *)fs_gpx );
+		}
+		cur_fs_gpx = fs_gpx;
+	}
 	
-	new_tag = (xml_tag *)xcalloc(sizeof(xml_tag),1);
-	new_tag->tagname = xstrdup(el);
+	new_tag = fs_xml_tag_alloc(fs_gpx);
+	new_tag->tagname = fs_xml_strdup(fs_gpx, el);
 	
 	/* count attributes */
 	while (*avp) {
@@ -539,7 +594,7 @@ start_something_else(const char *el, const char **attrv)
 	
 	/* copy attributes */
 	avp = attrv;
-	new_tag->attributes = (char **)xcalloc(sizeof(char *),attr_count+1);
+	new_tag->attributes = (char **)fs_xml_calloc(fs_gpx, attr_count+1, sizeof(char *));
 	avcp = new_tag->attributes;
 	while (*avp) {
 		*avcp = xstrdup(*avp);
@@ -549,48 +604,68 @@ start_something_else(const char *el, const char **attrv)
 	*avcp = NULL;
 	
 	if ( cur_tag ) {
-		if ( cur_tag->child ) {
-			cur_tag = cur_tag->child;
-			while ( cur_tag->sibling ) {
-				cur_tag = cur_tag->sibling;
-			}
-			cur_tag->sibling = new_tag;
-			new_tag->parent = cur_tag->parent;
+		if ( cur_tag_tail ) {
+			cur_tag_tail->sibling = new_tag;
 		}
 		else {
 			cur_tag->child = new_tag;
-			new_tag->parent = cur_tag;
 		}
+		new_tag->parent = cur_tag;
 	}
-	else {
-		fs_gpx = (fs_xml *)fs_chain_find( *fs_ptr, FS_GPX );
-	       	
-		if ( fs_gpx && fs_gpx->tag ) {
-			cur_tag = fs_gpx->tag;
-			while ( cur_tag->sibling ) {
-				cur_tag = cur_tag->sibling;
-			}
-			cur_tag->sibling = new_tag;
-			new_tag->parent = NULL;
-		}
-		else {
-			fs_gpx = fs_xml_alloc(FS_GPX);
-			fs_gpx->tag = new_tag;
-			fs_chain_add( fs_ptr, (format_specific_data *)fs_gpx );
-			new_tag->parent = NULL;
+	else if ( fs_gpx->tag ) {
+		cur_tag = fs_gpx->tag;
+		while ( cur_tag->sibling ) {
+			cur_tag = cur_tag->sibling;
 		}
+		cur_tag->sibling = new_tag;
+		new_tag->parent = NULL;
+	}
+	else {
+		fs_gpx->tag = new_tag;
+		new_tag->parent = NULL;
 	}
 	cur_tag = new_tag;
+	cur_tag_tail = NULL;
 }
 
 static void
 end_something_else()
 {
 	if ( cur_tag ) {
+		cur_tag_tail = cur_tag;
 		cur_tag = cur_tag->parent;
 	}
 }
 
+/*
+ * gpx_append_cdata: append character data to a passthrough tag.  Only
+ * the reader appends, so the buffer size follows from the length: the
+ * next power of two that holds the string.
+ */
+
+static size_t
+gpx_cdata_size(size_t len)
+{
+	size_t size = 64;
+
+	while (size < len + 1)
+		size *= 2;
+	return size;
+}
+
+static void
+gpx_append_cdata(char **cdata, int *cdatalen, const char *s, int len)
+{
+	size_t need = *cdatalen + len;
+
+	if ((*cdata == NULL) || (gpx_cdata_size(need) > gpx_cdata_size(*cdatalen))) {
+		*cdata = xrealloc(*cdata, gpx_cdata_size(need));
+	}
+	memcpy(*cdata + *cdatalen, s, len);
+	(*cdata)[need] = '\0';
+	*cdatalen = need;
+}
+
 static void
 tag_log_wpt(const char **attrv)
 {
@@ -603,12 +678,10 @@ tag_log_wpt(const char **attrv)
 	/* extract the lat/lon attributes */
 	while (*avp) { 
 		if (strcmp(avp[0], "lat") == 0) {
-			sscanf(avp[1], "%lf", 
-				&lwp_tmp->latitude);
+			gb_parse_dbl(avp[1], &lwp_tmp->latitude);
 		}
 		else if (strcmp(avp[0], "lon") == 0) {
-			sscanf(avp[1], "%lf", 
-			&lwp_tmp->longitude);
+			gb_parse_dbl(avp[1], &lwp_tmp->longitude);
 		}
 		avp+=2;
 	}
@@ -633,25 +706,36 @@ static void
 gpx_start(void *data, const XML_Char *xml_el, const XML_Char **xml_attr)
 {
 	char *e;
-	char *ep;
 	int passthrough;
 	int tag;
+	size_t ellen;
+	tag_level *lvl;
 	const char *el = xml_convert_to_char_string(xml_el);
 	const char **attr = xml_convert_attrs_to_char_string(xml_attr);
 
-	vmem_realloc(&current_tag, strlen(current_tag.mem) + 2 + strlen(el));
-	e = current_tag.mem;
-	ep = e + strlen(e);
-	*ep++ = '/';
-	strcpy(ep, el);
+	if (++tag_depth == tag_stack_sz) {
+		tag_stack_sz *= 2;
+		tag_stack = xrealloc(tag_stack, tag_stack_sz * sizeof(*tag_stack));
+	}
+	lvl = &tag_stack[tag_depth];
+	ellen = strlen(el);
+	vmem_realloc(&current_tag, lvl[-1].len + 2 + ellen);
+	e = (char *) current_tag.mem + lvl[-1].len;
+	*e = '/';
+	memcpy(e + 1, el, ellen + 1);
+	lvl->len = lvl[-1].len + 1 + ellen;
+	lvl->crc = get_crc32_s_append(lvl[-1].crc, e);
+	lvl->tag = get_tag(current_tag.mem, lvl->crc, &lvl->passthrough);
 
 	
 	/*
 	 * Reset end-of-string without actually emptying/reallocing cdatastr.
 	 */
 	*(char *) cdatastr.mem = 0;
+	cdatalen = 0;
 
-	tag = get_tag(current_tag.mem, &passthrough);
+	tag = lvl->tag;
+	passthrough = lvl->passthrough;
 	switch (tag) {
 	case tt_gpx:
 		tag_gpx(attr);
@@ -858,13 +942,20 @@ xml_parse_time( const char *cdatastr, int *microsecs )
 		*pointstr = '\0';
 	}
 	
-	sscanf(timestr, "%d-%d-%dT%d:%d:%d", 
-		&tm.tm_year,
-		&tm.tm_mon,
-		&tm.tm_mday,
-		&tm.tm_hour,
-		&tm.tm_min,
-		&tm.tm_sec);
+	/* the usual YYYY-MM-DDTHH:MM:SS is taken apart by column */
+	if (! (gb_scan_int(timestr, 4, &tm.tm_year) && (timestr[4] == '-') &&
+	       gb_scan_int(timestr + 5, 2, &tm.tm_mon) && (timestr[7] == '-') &&
+	       gb_scan_int(timestr + 8, 2, &tm.tm_mday) && (timestr[10] == 'T') &&
+	       gb_scan_int(timestr + 11, 2, &tm.tm_hour) && (timestr[13] == ':') &&
+	       gb_scan_int(timestr + 14, 2, &tm.tm_min) && (timestr[16] == ':') &&
+	       gb_scan_int(timestr + 17, 2, &tm.tm_sec) && ! isdigit(timestr[19])))
+		sscanf(timestr, "%d-%d-%dT%d:%d:%d", 
+			&tm.tm_year,
+			&tm.tm_mon,
+			&tm.tm_mday,
+			&tm.tm_hour,
+			&tm.tm_min,
+			&tm.tm_sec);
 	tm.tm_mon -= 1;
 	tm.tm_year -= 1900;
 	tm.tm_isdst = 0;
@@ -880,7 +971,7 @@ static void
 gpx_end(void *data, const XML_Char *xml_el)
 {
 	const char *el = xml_convert_to_char_string(xml_el);
-	char *s = strrchr(current_tag.mem, '/');
+	char *s = (char *) current_tag.mem + tag_stack[tag_depth - 1].len;
 	float x;
 	char *cdatastrp = cdatastr.mem;
 	int passthrough;
@@ -891,7 +982,8 @@ gpx_end(void *data, const XML_Char *xml_el)
 		fprintf(stderr, "Mismatched tag %s\n", el);
 	}
 
-	tag = get_tag(current_tag.mem, &passthrough);
+	tag = tag_stack[tag_depth].tag;
+	passthrough = tag_stack[tag_depth].passthrough;
 	switch(tag) {
 	/*
 	 * First, the tags that are file-global.
@@ -927,11 +1019,11 @@ gpx_end(void *data, const XML_Char *xml_el)
 	case tt_wpt:
 		waypt_add(wpt_tmp);
 		logpoint_ct = 0;
-		cur_tag = NULL;
+		cur_tag = cur_tag_tail = NULL;
 		wpt_tmp = NULL;
 		break;
 	case tt_cache_name:
-		if (wpt_tmp->notes != NULL) xfree(wpt_tmp->notes);
+		if (wpt_tmp->notes != NULL) strpool_release(wpt_tmp->notes);
 		wpt_tmp->notes = xstrdup(cdatastrp);
 		break;
 	case tt_cache_container:
@@ -1062,7 +1154,7 @@ gpx_end(void *data, const XML_Char *xml_el)
 	case tt_wpt_ele:
 	case tt_rte_rtept_ele:
 	case tt_trk_trkseg_trkpt_ele:
-		sscanf(cdatastrp, "%lf", &wpt_tmp->altitude);
+		gb_parse_dbl(cdatastrp, &wpt_tmp->altitude);
 		break;
 	case tt_wpt_name:
 	case tt_rte_rtept_name:
@@ -1088,7 +1180,7 @@ gpx_end(void *data, const XML_Char *xml_el)
 	case tt_wpt_desc:
 	case tt_trk_trkseg_trkpt_desc:
 	case tt_rte_rtept_desc:
-		if (wpt_tmp->notes != NULL) xfree(wpt_tmp->notes);
+		if (wpt_tmp->notes != NULL) strpool_release(wpt_tmp->notes);
 		wpt_tmp->notes = xstrdup(cdatastrp);
 		break;
 	case tt_pdop:
@@ -1142,6 +1234,8 @@ gpx_end(void *data, const XML_Char *xml_el)
 	case tt_unknown:
 		end_something_else();
 		*s = 0;
+		tag_depth--;
+		cdatalen = strlen(cdatastr.mem);
 		return;
 	default:
 		break;
@@ -1152,6 +1246,9 @@ gpx_end(void *data, const XML_Char *xml_el)
 	}
 
 	*s = 0;
+	tag_depth--;
+	/* the handlers above may have trimmed cdatastr */
+	cdatalen = strlen(cdatastr.mem);
 	xml_free_converted_string(el);
 }
 
@@ -1173,38 +1270,27 @@ static void
 gpx_cdata(void *dta, const XML_Char *xml_el, int len)
 {
 	char *estr;
-	int *cdatalen;
-	char **cdata;
-	xml_tag *tmp_tag;
-	size_t slen = strlen(cdatastr.mem);
 	const char *s = xml_convert_to_char_string_n(xml_el, &len);
 
-	vmem_realloc(&cdatastr,  1 + len + slen);
-	estr = ((char *) cdatastr.mem) + slen;
+	/* grow geometrically, text nodes may come in many small pieces */
+	if (cdatalen + len + 1 > cdatastr.size) {
+		vmem_realloc(&cdatastr, 2 * (cdatalen + len + 1));
+	}
+	estr = ((char *) cdatastr.mem) + cdatalen;
 	memcpy(estr, s, len);
 	estr[len]  = 0;
+	cdatalen += len;
 
  	if (!cur_tag)
 		return;
 
-		if ( cur_tag->child ) {
-			tmp_tag = cur_tag->child;
-			while ( tmp_tag->sibling ) {
-				tmp_tag = tmp_tag->sibling;
-			}
-			cdata = &(tmp_tag->parentcdata);
-			cdatalen = &(tmp_tag->parentcdatalen);
+		if ( cur_tag_tail ) {
+			gpx_append_cdata(&cur_tag_tail->parentcdata,
+				&cur_tag_tail->parentcdatalen, s, len);
 		}
 		else {
-			cdata = &(cur_tag->cdata);
-			cdatalen = &(cur_tag->cdatalen);
+			gpx_append_cdata(&cur_tag->cdata, &cur_tag->cdatalen, s, len);
 		}
-		estr = *cdata;
-		*cdata = xrealloc(*cdata, *cdatalen + len + 1);
-		estr = *cdata + *cdatalen;
-		memcpy( estr, s, len );
-		*(estr+len) = '\0';
-		*cdatalen += len;
 
 	xml_free_converted_string(s);
 }
@@ -1227,6 +1313,9 @@ gpx_rd_init(const char *fname)
 	file_time = 0;
 	current_tag = vmem_alloc(1, 0);
 	*((char *)current_tag.mem) = '\0';
+	tag_stack_sz = 16;
+	tag_stack = xcalloc(tag_stack_sz, sizeof(*tag_stack));
+	tag_depth = 0;
 
 	prescan_tags();
 	
@@ -1238,6 +1327,7 @@ gpx_rd_init(const char *fname)
 
 	cdatastr = vmem_alloc(1, 0);
 	*((char *)cdatastr.mem) = '\0';
+	cdatalen = 0;
 
 	if (!xsi_schema_loc) {
 		xsi_schema_loc = xstrdup(DEFAULT_XSI_SCHEMA_LOC);
@@ -1268,6 +1358,8 @@ void
 gpx_rd_deinit(void) 
 {
 	vmem_free(&current_tag);
+	xfree(tag_stack);
+	tag_stack = NULL;
 	vmem_free(&cdatastr);
 	/* 
 	 * Don't free schema_loc.  It really is important that we preserve
@@ -1296,8 +1388,10 @@ gpx_rd_deinit(void)
 	XML_ParserFree(psr);
 	psr = NULL;
 	wpt_tmp = NULL;
-	cur_tag = NULL;
+	cur_tag = cur_tag_tail = NULL;
 	input_fname = NULL;
+	xfree(tag_hash);
+	tag_hash = NULL;
 }
 #endif
 
@@ -1307,6 +1401,7 @@ gpx_wr_init(const char *fname)
 	mkshort_handle = mkshort_new_handle();
 
 	ofd = gbfopen(fname, "w", MYNAME);
+	track_set_views(1);
 }
 
 static void
@@ -1316,80 +1411,120 @@ gpx_wr_deinit(void)
 	mkshort_del_handle(&mkshort_handle);
 }
 
+#if HAVE_LIBEXPAT
+/*
+ * The majority of this function is a disgusting hack to correct
+ * defective GPX files that Geocaching.com issues as pocket queries.
+ * They contain escape characters as entities (&#x00-&#x1f) which makes
+ * them not validate which croaks expat and torments users.
+ *
+ * Strip them from buf, which holds len bytes and a terminator, and
+ * return the new length.
+ */
+static int
+gpx_strip_bad_entities(char *buf, int len)
+{
+	char hex[]="0123456789abcdef";
+	char *badchar = strstr( buf, "&#x" );
+	char *semi;
+
+	while ( badchar ) {
+		int val = 0;
+		char *hexit = badchar+3;
+		semi = strchr( badchar, ';' );
+		if ( semi ) {
+			while (*hexit && *hexit != ';') {
+				char hc = isalpha(*hexit) ? tolower (*hexit) : *hexit;
+				val *= 16;
+				val += strchr( hex, hc)-hex;
+				hexit++;
+			}
+
+			if ( val < 32 ) {
+				warning( MYNAME ": Ignoring illegal character %.*s;\n\tConsider emailing %s at <%s>\n\tabout illegal characters in their GPX files.\n", (int) (semi-badchar), badchar, gpx_author?gpx_author:"(unknown author)", gpx_email?gpx_email:"(unknown email address)" );
+				memmove( badchar, semi+1, strlen(semi+1)+1 );
+				len -= (semi-badchar)+1;
+				badchar--;
+			}
+		}
+		badchar = strstr( badchar+1, "&#x" );
+	}
+	return len;
+}
+
+/*
+ * Does the chunk contain a hex character reference?
+ */
+static int
+gpx_has_hex_entity(const char *chunk, int len)
+{
+	const char *end = chunk + len;
+	const char *amp = chunk;
+
+	while ((amp = memchr(amp, '&', end - amp)) != NULL) {
+		if ((end - amp >= 3) && (amp[1] == '#') && (amp[2] == 'x')) {
+			return 1;
+		}
+		amp++;
+	}
+	return 0;
+}
+#endif
+
 void
 gpx_read(void)
 {
 #if HAVE_LIBEXPAT
-	int len;
 	int done = 0;
-	char *buf = xmalloc(MY_CBUF_SZ);
+	char *buf = NULL;
+	int bufsz = 0;
 	int result = 0;
-	int extra;
 
 	while (!done) {
 		if ( fd ) {
-			/* 
-			 * The majority of this block (in fact, all but the 
-			 * call to XML_Parse) are a disgusting hack to 
-			 * correct defective GPX files that Geocaching.com
-			 * issues as pocket queries.   They contain escape
-			 * characters as entities (&#x00-&#x1f) which makes
-			 * them not validate which croaks expat and torments
-			 * users.
-			 *
-			 * Look for '&' in the last maxentlength chars.   If 
-			 * we find it, strip it, then read byte-at-a-time 
-			 * until we find a non-entity.
+			/*
+			 * The file is handed to expat in large chunks straight
+			 * out of the read buffer, which for a regular file is
+			 * the file mapped into memory.  Every chunk but the last
+			 * ends before a '<', so no entity is ever split between
+			 * two chunks; only the rare chunk that has one of the
+			 * entities stripped above gets copied.
 			 */
-			char *badchar;
-			char *semi;
-			int maxentlength = 8;
-			len = gbfread(buf, 1, MY_CBUF_SZ - maxentlength, fd);
-			done = gbfeof(fd) || !len;
-			buf[len] = '\0';
-			if (len < maxentlength) {
-				maxentlength = len;
-			}
-			badchar = buf+len-maxentlength;
-			badchar = strchr( badchar, '&' );
-			extra = maxentlength - 1; /* for terminator */
-			while ( badchar && len < MY_CBUF_SZ-1) {
-				semi = strchr( badchar, ';');
-				while ( extra && !semi ) {
-					len += gbfread( buf+len, 1, 1, fd);
-					buf[len]='\0';
-					extra--;
-					if ( buf[len-1] == ';') 
-						semi= buf+len-1;
+			gbsize_t count = MY_CBUF_SZ;
+			const char *chunk = gbfpeekptr(fd, &count);
+			int len = count;
+
+			done = (count < MY_CBUF_SZ);
+			if (!done) {
+				const char *lt = chunk + len;
+
+				while ((lt > chunk) && (*--lt != '<'));
+				if (lt > chunk) {
+					len = lt - chunk;
 				}
-				badchar = strchr( badchar+1, '&' );
-			} 
-			{
-				char hex[]="0123456789abcdef";
-				badchar = strstr( buf, "&#x" );
-				while ( badchar ) {
-					int val = 0;
-					char *hexit = badchar+3;
-					semi = strchr( badchar, ';' );
-					if ( semi ) {
-						while (*hexit && *hexit != ';') {
-							char hc = isalpha(*hexit) ? tolower (*hexit) : *hexit;
-							val *= 16;
-							val += strchr( hex, hc)-hex;
-							hexit++;
-						}
-
-						if ( val < 32 ) {
-							warning( MYNAME ": Ignoring illegal character %s;\n\tConsider emailing %s at <%s>\n\tabout illegal characters in their GPX files.\n", badchar, gpx_author?gpx_author:"(unknown author)", gpx_email?gpx_email:"(unknown email address)" );
-							memmove( badchar, semi+1, strlen(semi+1)+1 );
-							len -= (semi-badchar)+1;
-							badchar--;
-						}
+				/* all text; keep a trailing entity for the next chunk */
+				else {
+					const char *amp = chunk + len;
+
+					while ((amp > chunk + len - 8) && (*--amp != '&'));
+					if ((*amp == '&') && (amp > chunk)) {
+						len = amp - chunk;
 					}
-					badchar = strstr( badchar+1, "&#x" );
-				} 
+				}
 			}
-			result = XML_Parse(psr, buf, len, done);
+			gbfreadptr(fd, len);
+
+			if (gpx_has_hex_entity(chunk, len)) {
+				if (len >= bufsz) {
+					bufsz = len + 1;
+					buf = xrealloc(buf, bufsz);
+				}
+				memcpy(buf, chunk, len);
+				buf[len] = '\0';
+				len = gpx_strip_bad_entities(buf, len);
+				chunk = buf;
+			}
+			result = XML_Parse(psr, chunk, len, done);
 		}
 		else if (input_string) {
 			done = 0;
@@ -1408,7 +1543,9 @@ gpx_read(void)
 				XML_ErrorString(XML_GetErrorCode(psr)));
 		}
 	}
-	xfree(buf);
+	if (buf) {
+		xfree(buf);
+	}
 #endif /* HAVE_LIBEXPAT */
 }
 
@@ -1440,7 +1577,7 @@ fprint_xml_chain( xml_tag *tag, const waypoint *wpt )
 		
 			if ( tag->cdata ) {
 				tmp_ent = xml_entitize( tag->cdata );
-				gbfprintf( ofd, "%s", tmp_ent );
+				gbfputs( tmp_ent, ofd );
 				xfree(tmp_ent);
 			}
 			if ( tag->child ) {
@@ -1455,7 +1592,7 @@ fprint_xml_chain( xml_tag *tag, const waypoint *wpt )
 		}
 		if ( tag->parentcdata ) {
 			tmp_ent = xml_entitize(tag->parentcdata);
-			gbfprintf(ofd, "%s", tmp_ent );
+			gbfputs(tmp_ent, ofd);
 			xfree(tmp_ent);
 		}
 		tag = tag->sibling;	
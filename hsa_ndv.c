@@ -428,7 +428,7 @@ static void readVersion4(gbfile* pFile)
 		{		
 			// read vertex position
 			if( !readPositionRecord( pFile, &lat2, &lng2, pts2) ) {
-				xfree(wpt_tmp);
+				waypt_free(wpt_tmp);
 				return;
 			}
 
@@ -440,13 +440,13 @@ static void readVersion4(gbfile* pFile)
 
 		// read the class name
 		if( !readRecord( pFile, EF_CLNM_REC, className) ) {
-			xfree( wpt_tmp );
+			waypt_free( wpt_tmp );
 			return;
 		}
 
 		// read the attributes name
 		if( !readRecord( pFile, EF_ATTR_REC, attr) ) {
-			xfree( wpt_tmp );
+			waypt_free( wpt_tmp );
 			return;
 		}
 		getAttr(attr, ATTR_OBJECTNAME, &wpt_tmp->shortname, '\x1f');
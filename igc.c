@@ -24,6 +24,7 @@
  */
 
 #include "defs.h"
+#include "gbnum.h"
 #include <errno.h>
 
 static gbfile *file_in, *file_out;
@@ -93,7 +94,7 @@ static igc_rec_type_t get_record(char **rec)
     size_t len;
     char *c;
 retry:
-    *rec = c = gbfgetstr(file_in);
+    *rec = c = gbfgetline(file_in);
     if ((lineno++ == 0) && file_in->unicode) cet_convert_init(CET_CHARSET_UTF8, 1);
     if (c == NULL) return rec_none;
 
@@ -327,8 +328,22 @@ static void data_read(void)
 		gnss_head->rte_desc = xstrdup(trk_desc);
 		track_add_head(gnss_head);
 	    }
-	    // Create a waypoint from the fix record data
-	    if (sscanf(ibuf,
+	    // Create a waypoint from the fix record data.  Well formed
+	    // records are taken apart by column, anything else by sscanf.
+	    if ((strlen(ibuf) >= 35) &&
+		gb_scan_uint(ibuf + 1, 2, &hours) && gb_scan_uint(ibuf + 3, 2, &mins) &&
+		gb_scan_uint(ibuf + 5, 2, &secs) && gb_scan_uint(ibuf + 7, 2, &lat_deg) &&
+		gb_scan_uint(ibuf + 9, 2, &lat_min) && gb_scan_uint(ibuf + 11, 3, &lat_frac) &&
+		((ibuf[14] == 'N') || (ibuf[14] == 'S')) &&
+		gb_scan_uint(ibuf + 15, 3, &lon_deg) && gb_scan_uint(ibuf + 18, 2, &lon_min) &&
+		gb_scan_uint(ibuf + 20, 3, &lon_frac) &&
+		((ibuf[23] == 'W') || (ibuf[23] == 'E')) &&
+		gb_scan_int(ibuf + 25, 5, &pres_alt) && gb_scan_int(ibuf + 30, 5, &gnss_alt)) {
+		lat_hemi[0] = ibuf[14];
+		lon_hemi[0] = ibuf[23];
+		validity = ibuf[24];
+	    }
+	    else if (sscanf(ibuf,
 		       "B%2u%2u%2u%2u%2u%3u%1[NS]%3u%2u%3u%1[WE]%c%5d%5d",
 		       &hours, &mins, &secs, &lat_deg, &lat_min, &lat_frac,
 		       lat_hemi, &lon_deg, &lon_min, &lon_frac, lon_hemi,
@@ -98,8 +98,8 @@ interpfilt_process(void)
 					timen += interval ) {
 				waypoint *wpt_new = waypt_dupe(wpt);
 				wpt_new->creation_time = timen;
-				if (wpt_new->shortname) xfree(wpt_new->shortname);
-				if (wpt_new->description) xfree(wpt_new->description);
+				if (wpt_new->shortname) strpool_release(wpt_new->shortname);
+				if (wpt_new->description) strpool_release(wpt_new->description);
 				wpt_new->shortname = wpt_new->description = NULL;
 				linepart( lat1, lon1, 
 					  wpt->latitude, wpt->longitude,
@@ -127,8 +127,8 @@ interpfilt_process(void)
 				waypoint *wpt_new = waypt_dupe(wpt);
 				wpt_new->creation_time = distn/curdist*
 					(wpt->creation_time - time1) + time1;
-				if (wpt_new->shortname) xfree(wpt_new->shortname);
-				if (wpt_new->description) xfree(wpt_new->description);
+				if (wpt_new->shortname) strpool_release(wpt_new->shortname);
+				if (wpt_new->description) strpool_release(wpt_new->description);
 				wpt_new->shortname = wpt_new->description = NULL;
 				linepart( lat1, lon1, 
 					  wpt->latitude, wpt->longitude,
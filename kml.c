@@ -22,6 +22,7 @@
 #include "defs.h"
 #include "xmlgeneric.h"
 #include "grtcirc.h"
+#include "gbnum.h"
 
 #ifdef __WIN32__
 # include <windows.h>
@@ -250,7 +251,6 @@ void wpt_icon(const char *args, const char **unused)
 
 void trk_coord(const char *args, const char **attrv)
 {
-	int consumed = 0;
 	double lat, lon, alt;
 	waypoint *trkpt;
 
@@ -260,7 +260,16 @@ void trk_coord(const char *args, const char **attrv)
 	}
 	track_add_head(trk_head);
 	
-	while (3 == sscanf(args, "%lf,%lf,%lf %n", &lon, &lat, &alt, &consumed)){
+	/* as sscanf(args, "%lf,%lf,%lf %n", ...) == 3, for every point */
+	for (;;) {
+		const char *p = args;
+
+		if (! (gb_scan_dbl(&p, &lon) && (*p++ == ',') &&
+		       gb_scan_dbl(&p, &lat) && (*p++ == ',') &&
+		       gb_scan_dbl(&p, &alt)))
+			break;
+		while (isspace((unsigned char) *p)) p++;
+
 		trkpt = waypt_new();	
 		trkpt->latitude = lat;
 		trkpt->longitude = lon;
@@ -268,7 +277,7 @@ void trk_coord(const char *args, const char **attrv)
 
 		track_add_wpt(trk_head, trkpt);
 
-		args += consumed;
+		args = p;
 	}
 }
 
@@ -359,6 +368,22 @@ kml_wr_position_deinit(void)
 	}
 }
 
+/*
+ * Write two spaces per indentation level, a whole run of them at once.
+ */
+static void
+kml_write_indent(void)
+{
+	static const char spaces[] = "                                ";
+	int n = 2 * indent_level;
+
+	while (n > 0) {
+		int len = (n < (int) sizeof(spaces) - 1) ? n : (int) sizeof(spaces) - 1;
+		gbfwrite(spaces, 1, len, ofd);
+		n -= len;
+	}
+}
+
 /*
  *  Indent is a direction to change indention level.
  * If positive, increase one level after printing this line.
@@ -369,15 +394,12 @@ static void
 kml_write_xml(int indent, const char *fmt, ...)
 {
 	va_list args;
-	int i;
 	va_start(args, fmt);
 
 	if (indent < 0) indent_level--;
 
 	if (fmt[1] != '!' && do_indentation) {
-		for (i = 0; i < indent_level; i++) {
-			gbfputs("  ", ofd);
-		}
+		kml_write_indent();
 	}
 
 	gbvfprintf(ofd, fmt, args);
@@ -394,12 +416,9 @@ kml_write_xml(int indent, const char *fmt, ...)
 static void
 kml_write_xmle(const char *tag, const char *v)
 {
-	int i;
 	if (v && *v) {
 		char *tmp_ent = xml_entitize(v);
-		for (i = 0; i < indent_level; i++) {
-			gbfputs("  ", ofd);
-		}
+		kml_write_indent();
 		gbfprintf(ofd, "<%s>%s</%s>\n",tag, tmp_ent, tag);
 		xfree(tmp_ent);
 	}
@@ -1228,7 +1247,7 @@ kml_wr_position(waypoint *wpt)
 	switch (wpt->fix) {
 		case fix_none:
 			if (wpt->shortname) {
-				xfree (wpt->shortname);
+				strpool_release(wpt->shortname);
 			}
 			wpt->shortname = xstrdup("ESTIMATED Position");
 			break;
@@ -1410,7 +1410,7 @@ mag_route_trl(const route_head * rte)
 	waypoint *waypointp;
 	char obuff[256];
 	char buff1[64], buff2[64];
-	char *pbuff, *owpt;
+	char *pbuff, *owpt, *tbuf;
 	const char * icon_token;
 	int i, numlines, thisline;
 	
@@ -1438,11 +1438,10 @@ mag_route_trl(const route_head * rte)
 		else
 			pbuff = buff2;
 
-		owpt = waypointp->shortname;
-		if (strlen(owpt) > sizeof(buff1) - 3) {
-			owpt[sizeof(buff1) - 3] = 0;
-		}
-		owpt = mag_cleanse(owpt);
+		/* the name may be shared with other waypoints; shorten a copy */
+		tbuf = xstrndup(waypointp->shortname, sizeof(buff1) - 3);
+		owpt = mag_cleanse(tbuf);
+		xfree(tbuf);
 
 		sprintf(pbuff, "%s,%s", owpt, icon_token);
 		
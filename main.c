@@ -234,8 +234,6 @@ main(int argc, char *argv[])
 	int opt_version = 0;
 	int did_something = 0;
 	const char *prog_name = argv[0]; /* argv is modified during processing */
-	queue *wpt_head_bak, *rte_head_bak, *trk_head_bak;	/* #ifdef UTF8_SUPPORT */
-	signed int wpt_ct_bak, rte_ct_bak, trk_ct_bak;	/* #ifdef UTF8_SUPPORT */
 	arg_stack_t *arg_stack = NULL;
 
 	global_opts.objective = wptdata;
@@ -262,7 +260,6 @@ main(int argc, char *argv[])
 	
 	init_vecs();
 	init_filter_vecs();
-	cet_register();
 	session_init();
 	waypt_init();
 	route_init();
@@ -360,6 +357,7 @@ main(int argc, char *argv[])
 
 				cet_convert_strings(global_opts.charset, NULL, NULL);
 				cet_convert_deinit();
+				track_compact_all();
 				
 				did_something = 1;
 				break;
@@ -380,12 +378,9 @@ main(int argc, char *argv[])
 					
 					cet_convert_init(ovecs->encode, ovecs->fixed_encode);
 
-					wpt_ct_bak = -1;
-					rte_ct_bak = -1;
-					trk_ct_bak = -1;
-					rte_head_bak = trk_head_bak = NULL;
-
+					track_set_views(0);
 					ovecs->wr_init(ofname);
+					if (!track_get_views()) track_expand_all();
 
 					if (global_opts.charset != &cet_cs_vec_utf8)
 					{
@@ -397,10 +392,6 @@ main(int argc, char *argv[])
 					 */
 					    int saved_status = global_opts.verbose_status;
 					    global_opts.verbose_status = 0;
-					    waypt_backup(&wpt_ct_bak, &wpt_head_bak);
-					    route_backup(&rte_ct_bak, &rte_head_bak);
-					    track_backup(&trk_ct_bak, &trk_head_bak);
-					    
 					    cet_convert_strings(NULL, global_opts.charset, NULL);
 					    global_opts.verbose_status = saved_status;
 					}
@@ -408,17 +399,8 @@ main(int argc, char *argv[])
 					ovecs->write();
 					ovecs->wr_deinit();
 					
+					cet_restore_strings();
 					cet_convert_deinit();
-					
-					if (wpt_ct_bak != -1) waypt_restore(wpt_ct_bak, wpt_head_bak);
-					if (rte_ct_bak != -1) {
-						route_restore( rte_head_bak);
-						xfree( rte_head_bak );
-					}
-					if (trk_ct_bak != -1) {
-						track_restore( trk_head_bak);
-						xfree( trk_head_bak );
-					}
 				}
 				break;
 			case 's':
@@ -482,6 +464,7 @@ main(int argc, char *argv[])
  				fvecs = find_filter_vec(optarg, &fvec_opts);
 
  				if (fvecs) {
+					track_expand_all();
  					if (fvecs->f_init) fvecs->f_init(fvec_opts);
  					fvecs->f_process();
  					if (fvecs->f_deinit) fvecs->f_deinit();
@@ -580,16 +563,20 @@ main(int argc, char *argv[])
 		
 		cet_convert_strings(global_opts.charset, NULL, NULL);
 		cet_convert_deinit();
+		track_compact_all();
 		
 		if (argc == 2 && ovecs) 
 		{
 			cet_convert_init(ovecs->encode, 1);
 			cet_convert_strings(NULL, global_opts.charset, NULL);
 			
+			track_set_views(0);
 			ovecs->wr_init(argv[1]);
+			if (!track_get_views()) track_expand_all();
 			ovecs->write();
 			ovecs->wr_deinit();
 			
+			cet_restore_strings();
 			cet_convert_deinit();
 		}
 	}
@@ -608,6 +595,7 @@ main(int argc, char *argv[])
 		cet_convert_init(CET_CHARSET_ASCII, 1);
 		cet_convert_strings(NULL, global_opts.charset, NULL);
 		waypt_disp_all(waypt_disp);
+		cet_restore_strings();
 		global_opts.verbose_status = saved_status;
 	}
 
@@ -695,9 +683,9 @@ main(int argc, char *argv[])
 	cet_deregister();
 	waypt_flush_all();
 	route_flush_all();
-	session_exit();
 	exit_vecs();
 	exit_filter_vecs();
+	session_exit();
 	inifile_done(global_opts.inifile);
 
 #ifdef DEBUG_MEM
@@ -796,7 +796,7 @@ mps_waypoint_w_uniqloc_wrapper(waypoint *wpt)
 			/* Not the same lat lon, so rename and add */
 			newName = mkshort(written_wpt_mkshort_handle, wpt->shortname);
 			wptfound = waypt_dupe(wpt);
-			xfree(wptfound->shortname);
+			strpool_release(wptfound->shortname);
 			wptfound->shortname = newName;
 			mps_waypoint_w(mps_file_out, mps_ver_out, wptfound, (1==0));
 			mps_wpt_q_add(&written_wpt_head, wpt);
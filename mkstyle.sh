@@ -1,26 +1,231 @@
-
 echo "/* This file is machine-generated from the contents of style/ */"
 echo "/* by mkstyle.sh.   Editing it by hand is an exeedingly bad idea. */"
-echo 
+echo
 
 echo "#include \"defs.h\""
 echo "#if CSVFMTS_ENABLED"
+echo "#include \"csv_util.h\""
 nstyles="0"
 for i in `dirname $0`/style/*.style
 do
 	A=`basename $i | sed "s/.style$//"`
 	[ $A = "README" ] && continue
 	[ $A = "custom.style" ] && continue
-	ALIST="{ \"$A\", $A } , $ALIST"
-	echo "static char $A[] = "
-	sed 's/\\/\\\\/;s/"/\\"/g;s/\(^.\)/"\1/g;s/\(.$\)/\1\\n"/g' $i
-	echo ";"
+	ALIST="{ \"$A\", &$A } , $ALIST"
+	echo
+	# Compile the style into an xcsv_style_t, applying the same rules
+	# as xcsv_parse_style_line() does to the lines of a style file.
+	LC_ALL=C awk -v name="$A" '
+	function isspace(c) {
+		return c != "" && index(" \t\n\v\f\r", c) > 0
+	}
+	# csv_stringtrim()
+	function trim(s, enc, max,   p1, p2, el, n) {
+		if (s == "")
+			return ""
+		p1 = 1
+		p2 = length(s)
+		while (p2 > p1 && isspace(substr(s, p2, 1)))
+			p2--
+		while (p1 < p2 && isspace(substr(s, p1, 1)))
+			p1++
+		if (!max)
+			max = 9999
+		el = length(enc)
+		if (el) {
+			while (n < max && p2 - p1 + 1 >= el * 2 &&
+			    substr(s, p1, el) == enc &&
+			    substr(s, p2 - el + 1, el) == enc) {
+				p2 -= el
+				p1 += el
+				n++
+			}
+		}
+		return substr(s, p1, p2 - p1 + 1)
+	}
+	function atoi(s,   n, neg) {
+		while (isspace(substr(s, 1, 1)))
+			s = substr(s, 2)
+		if (substr(s, 1, 1) == "-" || substr(s, 1, 1) == "+") {
+			neg = substr(s, 1, 1) == "-"
+			s = substr(s, 2)
+		}
+		while (s ~ /^[0-9]/) {
+			n = n * 10 + substr(s, 1, 1)
+			s = substr(s, 2)
+		}
+		return neg ? -n : n + 0
+	}
+	function token(t) {
+		return substr(line, 1, length(t)) == t
+	}
+	function constant(s) {
+		return (s in constants) ? constants[s] : s
+	}
+	function cstr(s,   out, c, i) {
+		if (s == "\001")
+			return "NULL"
+		out = "\""
+		for (i = 1; i <= length(s); i++) {
+			c = substr(s, i, 1)
+			if (c == "\\" || c == "\"")
+				out = out "\\" c
+			else if (c == "\t")
+				out = out "\\t"
+			else if (c == "\n")
+				out = out "\\n"
+			else if (c == "\r")
+				out = out "\\r"
+			else if (c < " " || c > "~")
+				out = out sprintf("\\%03o", ord[c])
+			else
+				out = out c
+		}
+		return out "\""
+	}
+	function field(s, isout,   n, part, i, key, val, pfc, opts) {
+		n = split(s, part, ",")
+		if (n == 0)
+			part[++n] = ""
+		key = val = pfc = "\001"
+		opts = 0
+		key = trim(part[1], "\"", 1)
+		if (n > 1) val = trim(part[2], "\"", 1)
+		if (n > 2) pfc = trim(part[3], "\"", 1)
+		if (isout && n > 3) {
+			if (index(part[4], "no_delim_before")) opts = or1(opts, 1)
+			if (index(part[4], "absolute")) opts = or1(opts, 2)
+			if (index(part[4], "optional")) opts = or1(opts, 3)
+		}
+		return "\t{ " cstr(key) ", " cstr(val) ", " cstr(pfc) ", " opts " }"
+	}
+	# bitwise or of small option masks, without relying on gawk
+	function or1(a, b,   r, bit) {
+		for (bit = 1; bit <= 2; bit *= 2)
+			if (int(a / bit) % 2 || int(b / bit) % 2)
+				r += bit
+		return r + 0
+	}
+	function list(a, n, type, suffix,   i) {
+		if (!n)
+			return
+		printf("static %s%s_%s[] = {\n", type, name, suffix)
+		for (i = 1; i <= n; i++)
+			printf("%s,\n", a[i])
+		if (suffix == "prologue" || suffix == "epilogue")
+			printf("\tNULL\n")
+		printf("};\n")
+	}
+	BEGIN {
+		for (i = 1; i < 256; i++)
+			ord[sprintf("%c", i)] = i
+		constants["COMMA"] = ","
+		constants["COMMASPACE"] = ", "
+		constants["SINGLEQUOTE"] = "\047"
+		constants["DOUBLEQUOTE"] = "\""
+		constants["COLON"] = ":"
+		constants["SEMICOLON"] = ";"
+		constants["NEWLINE"] = "\n"
+		constants["CR"] = "\n"
+		constants["CRNEWLINE"] = "\r\n"
+		constants["TAB"] = "\t"
+		constants["SPACE"] = " "
+		constants["HASH"] = "#"
+		constants["WHITESPACE"] = "\\w"
+		constants["PIPE"] = "|"
+		desc = ext = fdelim = rdelim = badchars = enc = datum = "\001"
+		type = "ff_type_file"
+		datatype = 0
+		shortlen = shortwhite = -1
+	}
+	{
+		line = $0
+		if ((p = index(line, "#")) > 0) {
+			if (p > 1 && substr(line, p - 1, 1) == "\\")
+				line = substr(line, 1, p - 2) substr(line, p)
+			else
+				line = substr(line, 1, p - 1)
+		}
+		if (line == "")
+			next
+		if (token("FIELD_DELIMITER")) {
+			fdelim = constant(trim(substr(line, 17), "\"", 1))
+			p = trim(fdelim, " ", 0)
+			if (p == "\\w")
+				p = " \n\r"
+			badchars = (badchars == "\001" ? "" : badchars) p
+		} else if (token("RECORD_DELIMITER")) {
+			rdelim = constant(trim(substr(line, 18), "\"", 1))
+			badchars = (badchars == "\001" ? "" : badchars) trim(rdelim, " ", 0)
+		} else if (token("FORMAT_TYPE")) {
+			p = substr(line, 12)
+			while (isspace(substr(p, 1, 1)))
+				p = substr(p, 2)
+			if (substr(p, 1, 8) == "INTERNAL")
+				type = "ff_type_internal"
+			if (substr(p, 1, 6) == "SERIAL")
+				type = "ff_type_serial"
+		} else if (token("DESCRIPTION")) {
+			desc = trim(substr(line, 12), "", 0)
+		} else if (token("EXTENSION")) {
+			ext = trim(substr(line, 11), "", 0)
+		} else if (token("SHORTLEN")) {
+			shortlen = atoi(substr(line, 10))
+		} else if (token("SHORTWHITE")) {
+			shortwhite = atoi(substr(line, 13))
+		} else if (token("BADCHARS")) {
+			badchars = (badchars == "\001" ? "" : badchars) constant(trim(substr(line, 10), "\"", 1))
+		} else if (token("PROLOGUE")) {
+			prologue[++nprologue] = "\t" cstr(substr(line, 10))
+		} else if (token("EPILOGUE")) {
+			epilogue[++nepilogue] = "\t" cstr(substr(line, 10))
+		} else if (token("ENCODING")) {
+			enc = trim(substr(line, 9), "\"", 1)
+		} else if (token("DATUM")) {
+			datum = trim(substr(line, 6), "\"", 1)
+		} else if (token("DATATYPE")) {
+			p = toupper(trim(substr(line, 9), "\"", 1))
+			if (p == "TRACK")
+				datatype = "trkdata"
+			else if (p == "ROUTE")
+				datatype = "rtedata"
+			else if (p == "WAYPOINT")
+				datatype = "wptdata"
+			else {
+				printf("%s: Unknown data type \"%s\"!\n", FILENAME, p) > "/dev/stderr"
+				failed = 1
+				exit 1
+			}
+		} else if (token("IFIELD")) {
+			ifield[++nifield] = field(substr(line, 7), 0)
+		} else if (token("OFIELD")) {
+			ofield[++nofield] = field(substr(line, 7), 1)
+		}
+	}
+	END {
+		if (failed)
+			exit 1
+		list(prologue, nprologue, "char *", "prologue")
+		list(epilogue, nepilogue, "char *", "epilogue")
+		list(ifield, nifield, "xcsv_field_def_t ", "ifield")
+		list(ofield, nofield, "xcsv_field_def_t ", "ofield")
+		printf("static xcsv_style_t %s = {\n", name)
+		printf("\t%s,\n\t%s,\n", cstr(desc), cstr(ext))
+		printf("\t%s,\n\t%s,\n\t%s,\n", cstr(fdelim), cstr(rdelim), cstr(badchars))
+		printf("\t%s,\n\t%s,\n", cstr(enc), cstr(datum))
+		printf("\t%s,\n\t%s,\n\t%d,\n\t%d,\n", type, datatype, shortlen, shortwhite)
+		printf("\t%s,\n", nprologue ? name "_prologue" : "NULL")
+		printf("\t%s,\n", nepilogue ? name "_epilogue" : "NULL")
+		printf("\t%s, %d,\n", nifield ? name "_ifield" : "NULL", nifield)
+		printf("\t%s, %d\n", nofield ? name "_ofield" : "NULL", nofield)
+		printf("};\n")
+	}' $i || exit 1
 	nstyles=`expr $nstyles + 1`;
 done
+echo
 echo "style_vecs_t style_list[] = {$ALIST {0,0}};"
 echo "size_t nstyles = $nstyles;"
 echo "#else /* CSVFMTS_ENABLED */"
 echo "style_vecs_t style_list[] = {{0,0}};"
 echo "size_t nstyles = 0;"
 echo "#endif /* CSVFMTS_ENABLED */"
-
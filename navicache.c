@@ -181,7 +181,7 @@ nav_start(void *data, const XML_Char *xml_el, const XML_Char **xml_attr)
 			} else
 			if (0 == strcmp(ap[0], "retired")) {
 				if (!strcmp(ap[1], "yes") && noretired) {
-				    xfree(wpt_tmp);
+				    waypt_free(wpt_tmp);
 				    return;
 				}
 			} else
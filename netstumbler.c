@@ -301,7 +301,7 @@ fix_netstumbler_dupes(void)
 	for (i = 0, bh = htable; i < ct; i++, bh++) {
 		if (last_crc == bh->crc) {
 			snprintf(ssid, sizeof ssid, "%s/%d", bh->wpt->shortname, ++serial);
-			xfree(bh->wpt->shortname);
+			strpool_release(bh->wpt->shortname);
 			bh->wpt->shortname = xstrdup(ssid);
 		} else
 			last_crc = bh->crc;
@@ -24,6 +24,7 @@
 #include <time.h>
 
 #include "defs.h"
+#include "gbnum.h"
 #include "gbser.h"
 #include "strptime.h"
 #include "jeeps/gpsmath.h"
@@ -279,7 +280,7 @@ nmea_rd_init(const char *fname)
  			return;
  		}
  		if (wpt->shortname) {
- 			xfree(wpt->shortname);
+ 			strpool_release(wpt->shortname);
  		}
  		wpt->shortname = xstrdup("Position");
  		nmea_add_wpt(wpt, NULL);
@@ -420,29 +421,83 @@ gpgll_parse(char *ibuf)
 	curr_waypt = waypt;
 }
 
+/*
+ * Field scanners for the position sentences.  Each behaves like the
+ * sscanf conversion it replaces, and a scan stops at the first failure.
+ */
+
+static int
+scan_sep(const char **p)
+{
+	if (**p != ',') return 0;
+	(*p)++;
+	return 1;
+}
+
+static int
+scan_chr(const char **p, char *c)
+{
+	if (**p == '\0') return 0;
+	*c = *(*p)++;
+	return 1;
+}
+
+static int
+scan_int(const char **p, int *i)
+{
+	char *end;
+	long val = strtol(*p, &end, 10);
+
+	if (end == *p) return 0;
+	*i = val;
+	*p = end;
+	return 1;
+}
+
+static int
+scan_uint(const char **p, unsigned int *u)
+{
+	char *end;
+	unsigned long val = strtoul(*p, &end, 10);
+
+	if (end == *p) return 0;
+	*u = val;
+	*p = end;
+	return 1;
+}
+
 static void
 gpgga_parse(char *ibuf)
 {
-	double latdeg, lngdeg;
-	char lngdir, latdir;
-	double hms;
-	double alt;
+	double latdeg = 0, lngdeg = 0;
+	char lngdir = 0, latdir = 0;
+	double hms = 0;
+	double alt = 0;
 	int fix = fix_unknown;
 	int nsats = 0;
-	double hdop;
-	char altunits;
+	double hdop = 0;
+	char altunits = 0;
 	waypoint *waypt;
 	double microseconds;
+	const char *p;
 
 	if (trk_head == NULL) {
 		trk_head = route_head_alloc();
 		track_add_head(trk_head);
 	}
 
-	sscanf(ibuf,"$GPGGA,%lf,%lf,%c,%lf,%c,%d,%d,%lf,%lf,%c",
-		&hms, &latdeg,&latdir,
-		&lngdeg,&lngdir,
-		&fix,&nsats,&hdop,&alt,&altunits);
+	/* as sscanf(ibuf,"$GPGGA,%lf,%lf,%c,%lf,%c,%d,%d,%lf,%lf,%c",...) */
+	p = ibuf + 7;
+	(void) (gb_scan_dbl(&p, &hms) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &latdeg) && scan_sep(&p) &&
+		scan_chr(&p, &latdir) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &lngdeg) && scan_sep(&p) &&
+		scan_chr(&p, &lngdir) && scan_sep(&p) &&
+		scan_int(&p, &fix) && scan_sep(&p) &&
+		scan_int(&p, &nsats) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &hdop) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &alt) && scan_sep(&p) &&
+		scan_chr(&p, &altunits));
 
 	/*
 	 * In serial mode, allow the fix with an invalid position through
@@ -500,24 +555,32 @@ gpgga_parse(char *ibuf)
 static void
 gprmc_parse(char *ibuf)
 {
-	double latdeg, lngdeg;
-	char lngdir, latdir;
-	double hms;
-	char fix;
-	unsigned int dmy;
-	double speed,course;
+	double latdeg = 0, lngdeg = 0;
+	char lngdir = 0, latdir = 0;
+	double hms = 0;
+	char fix = 0;
+	unsigned int dmy = 0;
+	double speed = 0, course = 0;
 	waypoint *waypt;
 	double microseconds;
+	const char *p;
 
 	if (trk_head == NULL) {
 		trk_head = route_head_alloc();
 		track_add_head(trk_head);
 	}
 
-	sscanf(ibuf,"$GPRMC,%lf,%c,%lf,%c,%lf,%c,%lf,%lf,%u",
-		&hms, &fix, &latdeg, &latdir,
-		&lngdeg, &lngdir,
-		&speed, &course, &dmy);
+	/* as sscanf(ibuf,"$GPRMC,%lf,%c,%lf,%c,%lf,%c,%lf,%lf,%u",...) */
+	p = ibuf + 7;
+	(void) (gb_scan_dbl(&p, &hms) && scan_sep(&p) &&
+		scan_chr(&p, &fix) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &latdeg) && scan_sep(&p) &&
+		scan_chr(&p, &latdir) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &lngdeg) && scan_sep(&p) &&
+		scan_chr(&p, &lngdir) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &speed) && scan_sep(&p) &&
+		gb_scan_dbl(&p, &course) && scan_sep(&p) &&
+		scan_uint(&p, &dmy));
 
 	if (fix != 'A') {
 		/* ignore this fix - it is invalid */
@@ -981,7 +1044,7 @@ nmea_read(void)
 
 	curr_waypt = NULL; 
 
-	while ((ibuf = gbfgetstr(file_in))) {
+	while ((ibuf = gbfgetline(file_in))) {
 		char *sdatum, *cx;
 		
 		line++;
@@ -1162,7 +1225,7 @@ nmea_wayptpr(const waypoint *wpt)
 		s = mkshort(mkshort_handle, wpt->shortname);
 	}
 
-	snprintf(obuf, sizeof(obuf),  "GPWPL,%08.3f,%c,%09.3f,%c,%s", 
+	gb_snprintf(obuf, sizeof(obuf),  "GPWPL,%08.3f,%c,%09.3f,%c,%s", 
 			fabs(lat), lat < 0 ? 'S' : 'N',
 			fabs(lon), lon < 0 ? 'W' : 'E', s
 
@@ -1240,7 +1303,7 @@ nmea_trackpt_pr(const waypoint *wpt)
 	}
 
 	if (opt_gprmc) {
-		snprintf(obuf, sizeof(obuf), "GPRMC,%010.3f,%c,%08.3f,%c,%09.3f,%c,%.2f,%.2f,%06d,,",
+		gb_snprintf(obuf, sizeof(obuf), "GPRMC,%010.3f,%c,%08.3f,%c,%09.3f,%c,%.2f,%.2f,%06d,,",
 				(double) hms + (wpt->microseconds / 1000000.0),
 				fix=='0' ? 'V' : 'A',
 				fabs(lat), lat < 0 ? 'S' : 'N',
@@ -1259,7 +1322,7 @@ nmea_trackpt_pr(const waypoint *wpt)
 		gbfprintf(file_out, "$%s*%02X\n", obuf, cksum);
 	}
 	if (opt_gpgga) {
-		snprintf(obuf, sizeof(obuf), "GPGGA,%010.3f,%08.3f,%c,%09.3f,%c,%c,%02d,%.1f,%.3f,M,0.0,M,,",
+		gb_snprintf(obuf, sizeof(obuf), "GPGGA,%010.3f,%08.3f,%c,%09.3f,%c,%c,%02d,%.1f,%.3f,M,0.0,M,,",
 				(double) hms + (wpt->microseconds / 1000000.0),
 				fabs(lat), lat < 0 ? 'S' : 'N',
 				fabs(lon), lon < 0 ? 'W' : 'E',
@@ -1271,7 +1334,7 @@ nmea_trackpt_pr(const waypoint *wpt)
 		gbfprintf(file_out, "$%s*%02X\n", obuf, cksum);
 	}
 	if ((opt_gpvtg) && (WAYPT_HAS(wpt, course) || WAYPT_HAS(wpt, speed))) {
-		snprintf(obuf,sizeof(obuf),"GPVTG,%.3f,T,0,M,%.3f,N,%.3f,K",
+		gb_snprintf(obuf,sizeof(obuf),"GPVTG,%.3f,T,0,M,%.3f,N,%.3f,K",
 			WAYPT_HAS(wpt, course) ? (wpt->course):(0),	
 			WAYPT_HAS(wpt, speed) ? MPS_TO_KNOTS(wpt->speed):(0),
 			WAYPT_HAS(wpt, speed) ? MPS_TO_KPH(wpt->speed):(0) );
@@ -1295,7 +1358,7 @@ nmea_trackpt_pr(const waypoint *wpt)
 		default:
 			fix=0;
 		}
-		snprintf(obuf,sizeof(obuf),"GPGSA,A,%c,,,,,,,,,,,,,%.1f,%.1f,%.1f",
+		gb_snprintf(obuf,sizeof(obuf),"GPGSA,A,%c,,,,,,,,,,,,,%.1f,%.1f,%.1f",
 			fix,
 			(wpt->pdop>0)?(wpt->pdop):(0),
 			(wpt->hdop>0)?(wpt->hdop):(0),
@@ -553,7 +553,7 @@ osm_node_tag(const char *args, const char **attrv)
 	}
 	else if (strcmp(key, "name:en") == 0) {
 		if (wpt->shortname)
-			xfree(wpt->shortname);
+			strpool_release(wpt->shortname);
 		wpt->shortname = xstrdup(str);
 	}
 	else if ((ikey = osm_feature_ikey(key)) >= 0) {
@@ -564,7 +564,7 @@ osm_node_tag(const char *args, const char **attrv)
 		if (wpt->notes) {
 			char *tmp;
 			xasprintf(&tmp, "%s; %s", wpt->notes, str);
-			xfree(wpt->notes);
+			strpool_release(wpt->notes);
 			wpt->notes = tmp;
 		}
 		else
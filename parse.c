@@ -29,6 +29,7 @@
 #include "defs.h"
 #include "jeeps/gpsmath.h"
 #include "strptime.h"
+#include "gbnum.h"
 
 /*
  * parse_distance:
@@ -46,7 +47,7 @@ parse_distance(const char *str, double *val, double scale, const char *module)
 	
 	if ((str == NULL) || (*str == '\0')) return 0;
 	
-	*val = strtod(str, &unit);
+	*val = gb_strtod(str, &unit);
 	if (unit == NULL)
 		fatal("%s: Unconvertable numeric value (%s)!\n", module, str);
 
@@ -89,7 +90,7 @@ parse_speed(const char *str, double *val, const double scale, const char *module
 	
 	if ((str == NULL) || (*str == '\0')) return 0;
 	
-	*val = strtod(str, &unit);
+	*val = gb_strtod(str, &unit);
 	if (unit == NULL)
 		fatal("%s: Unconvertable numeric value (%s)!\n", module, str);
 	
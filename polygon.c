@@ -20,6 +20,7 @@
  */
 #include "defs.h"
 #include "filterdefs.h"
+#include "gbnum.h"
 
 #if FILTERS_ENABLED
 #define MYNAME "Polygon filter"
@@ -256,12 +257,13 @@ polygon_process(void)
 	int first = 1;
 	int last = 0;
 	char *line;
+	const char *p;
 	gbfile *file_in;
 
 	file_in = gbfopen(polyfileopt, "r", MYNAME);
 	
         olat = olon = lat1 = lon1 = lat2 = lon2 = BADVAL;
-	while ((line = gbfgetstr(file_in))) {
+	while ((line = gbfgetline(file_in))) {
 	    char *pound = NULL;
 	    int argsfound = 0;
 	    
@@ -271,7 +273,8 @@ polygon_process(void)
 	    if ( pound ) *pound = '\0';
 	    
 	    lat2 = lon2 = BADVAL;
-	    argsfound = sscanf( line, "%lf %lf", &lat2, &lon2 );
+	    p = line;
+	    argsfound = gb_scan_dbl(&p, &lat2) ? 1 + gb_scan_dbl(&p, &lon2) : 0;
 	   
 	    if ( argsfound != 2 && strspn(line, " \t\n") < strlen(line)) {
                 warning(MYNAME 
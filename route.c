@@ -18,6 +18,8 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
+#include <float.h>
 #include "defs.h"
 #include "grtcirc.h"
 #include "session.h"
@@ -28,6 +30,24 @@ static int rte_head_ct;
 static int rte_waypts;
 static int trk_head_ct;
 static int trk_waypts;
+static int track_views;
+
+/*
+ * Readers look up several points of the same route in a row, so the name
+ * index of the last route searched is kept until that route changes.
+ */
+static const route_head *rte_index_head;
+static waypt_index_t *rte_index;
+
+static void
+route_drop_name_index(const route_head *rte)
+{
+	if (rte_index && rte == rte_index_head) {
+		waypt_index_free(rte_index);
+		rte_index = NULL;
+		rte_index_head = NULL;
+	}
+}
 
 void
 route_init(void)
@@ -66,7 +86,7 @@ route_head *
 route_head_alloc(void)
 {
 	route_head *rte_head;
-	rte_head = (route_head *) xcalloc(sizeof (*rte_head), 1);
+	rte_head = (route_head *) slab_alloc(session_route_slab(curr_session()));
 	QUEUE_INIT(&rte_head->Q);
 	QUEUE_INIT(&rte_head->waypoint_list);
         rte_head->line_color.bbggrr = -1;
@@ -76,6 +96,9 @@ route_head_alloc(void)
 	return rte_head;
 }
 
+static void track_columns_free(track_columns_t *c);
+static void track_expand(route_head *rte);
+
 static void
 any_route_free(route_head *rte)
 {
@@ -88,11 +111,15 @@ any_route_free(route_head *rte)
  	if ( rte->rte_url ) {
  		xfree(rte->rte_url);
  	}
+	route_drop_name_index(rte);
 	waypt_flush(&rte->waypoint_list);
+	if ( rte->columns ) {
+		track_columns_free( rte->columns );
+	}
 	if ( rte->fs ) {
 		fs_chain_destroy( rte->fs );
 	}
-	xfree(rte);
+	slab_free(session_route_slab(rte->session), rte);
 }
 
 
@@ -167,6 +194,9 @@ route_find_track_by_name(const char *name)
 static void
 any_route_add_wpt(route_head *rte, waypoint *wpt, int *ct, int synth )
 {
+	if ( rte->columns ) {
+		track_expand( rte );
+	}
 	ENQUEUE_TAIL(&rte->waypoint_list, &wpt->Q);
 	rte->rte_waypt_ct++;	/* waypoints in this route */
 	if ( ct ) {
@@ -178,6 +208,9 @@ any_route_add_wpt(route_head *rte, waypoint *wpt, int *ct, int synth )
 		wpt->shortname = xstrdup(tmpnam);
 		wpt->wpt_flags.shortname_is_synthetic = 1;
 	}
+	if ( rte == rte_index_head ) {
+		waypt_index_add( rte_index, wpt );
+	}
 }
 
 void 
@@ -196,9 +229,25 @@ waypoint *
 route_find_waypt_by_name( route_head *rh, const char *name )
 {
 	queue *elem, *tmp;
+	waypoint *waypointp;
+
+	if (rh->columns == NULL) {
+		if (rte_index_head != rh) {
+			route_drop_name_index(rte_index_head);
+			rte_index = waypt_index_new();
+			rte_index_head = rh;
+			QUEUE_FOR_EACH(&rh->waypoint_list, elem, tmp) {
+				waypt_index_add(rte_index, (waypoint *) elem);
+			}
+		}
+		waypointp = waypt_index_find(rte_index, name, 0);
+		if (waypointp) {
+			return waypointp;
+		}
+	}
 
 	QUEUE_FOR_EACH(&rh->waypoint_list, elem, tmp) {
-		waypoint *waypointp = (waypoint *) elem;
+		waypointp = (waypoint *) elem;
 		if (0 == strcmp(waypointp->shortname, name)) {
 			return waypointp;
 		}
@@ -212,6 +261,9 @@ any_route_del_wpt( route_head *rte, waypoint *wpt, int *ct)
 	dequeue( &wpt->Q );
 	rte->rte_waypt_ct--;
 	if ( ct ) (*ct)--;
+	if ( rte == rte_index_head ) {
+		waypt_index_del( rte_index, wpt );
+	}
 }
 
 void 
@@ -226,6 +278,291 @@ track_del_wpt( route_head *rte, waypoint *wpt )
 	any_route_del_wpt( rte, wpt, &trk_waypts );
 }
 
+/*
+ * Compact track storage.
+ *
+ * Most track points carry nothing but a position and a time.  Once a
+ * track has been read, track_compact_all() replaces such tracks by
+ * parallel arrays of latitude, longitude, altitude and time; the few
+ * other members that vary from point to point get a column of their own
+ * only when needed.  Everything else the points have in common is kept
+ * once, in a template waypoint.  A track is only stored this way if
+ * every point comes back bit for bit identical.
+ *
+ * route_disp() and friends hand compact points to their callbacks as
+ * short-lived waypoint views.  Anything that walks waypoint_list itself
+ * has to call track_expand_all() first; main() does so before filters
+ * and before writers that have not called track_set_views(1).
+ */
+
+struct track_columns {
+	waypoint tmpl;		/* members common to all points */
+	int count;
+	int max;
+	double *latitude;
+	double *longitude;
+	double *altitude;
+	time_t *creation_time;
+	/* sparse columns, NULL while every point matches tmpl */
+	int *microseconds;
+	float *speed;		/* UNSET_FLOAT if the flag isn't set */
+	float *course;		/* ditto */
+	float *hdop;
+	signed char *fix;
+	signed char *sat;
+	unsigned char *heartrate;
+	unsigned char *cadence;
+};
+
+#define UNSET_FLOAT FLT_MAX
+
+#define COLUMN_GROW(c, col) \
+	if ((c)->col) (c)->col = xrealloc((c)->col, (c)->max * sizeof(*(c)->col))
+
+/* Store val in a sparse column, creating it the first time val != dflt. */
+#define COLUMN_PUT(c, col, i, val, dflt) \
+	do { \
+		if (((c)->col == NULL) && ((val) != (dflt))) { \
+			int j_; \
+			(c)->col = xmalloc((c)->max * sizeof(*(c)->col)); \
+			for (j_ = 0; j_ < (i); j_++) (c)->col[j_] = (dflt); \
+		} \
+		if ((c)->col) (c)->col[i] = (val); \
+	} while (0)
+
+#define COLUMN_COPY(dst, src, col) \
+	if ((src)->col) { \
+		(dst)->col = xmalloc((dst)->max * sizeof(*(dst)->col)); \
+		memcpy((dst)->col, (src)->col, (src)->count * sizeof(*(src)->col)); \
+	}
+
+static float
+flagged_float(int flag, float val)
+{
+	return flag ? val : UNSET_FLOAT;
+}
+
+/*
+ * Fill in wpt as the i'th point of c.
+ */
+static void
+track_columns_view(const track_columns_t *c, int i, waypoint *wpt)
+{
+	memcpy(wpt, &c->tmpl, sizeof(*wpt));
+	QUEUE_INIT(&wpt->Q);
+	wpt->latitude = c->latitude[i];
+	wpt->longitude = c->longitude[i];
+	wpt->altitude = c->altitude[i];
+	wpt->creation_time = c->creation_time[i];
+	if (c->microseconds) wpt->microseconds = c->microseconds[i];
+	if (c->speed) {
+		wpt->wpt_flags.speed = (c->speed[i] != UNSET_FLOAT);
+		wpt->speed = wpt->wpt_flags.speed ? c->speed[i] : 0;
+	}
+	if (c->course) {
+		wpt->wpt_flags.course = (c->course[i] != UNSET_FLOAT);
+		wpt->course = wpt->wpt_flags.course ? c->course[i] : 0;
+	}
+	if (c->hdop) wpt->hdop = c->hdop[i];
+	if (c->fix) wpt->fix = (fix_type) c->fix[i];
+	if (c->sat) wpt->sat = c->sat[i];
+	if (c->heartrate) wpt->heartrate = c->heartrate[i];
+	if (c->cadence) wpt->cadence = c->cadence[i];
+}
+
+/*
+ * Start compact storage with wpt as the template, if it has nothing
+ * that would have to be owned by each point.
+ */
+static track_columns_t *
+track_columns_new(const waypoint *wpt)
+{
+	track_columns_t *c;
+
+	if (wpt->shortname || wpt->description || wpt->notes ||
+	    wpt->url || wpt->url_link_text || wpt->url_next ||
+	    wpt->wpt_flags.icon_descr_is_dynamic ||
+	    !waypt_empty_gc_data(wpt) || wpt->fs || wpt->extra_data)
+		return NULL;
+
+	c = xcalloc(1, sizeof(*c));
+	memcpy(&c->tmpl, wpt, sizeof(c->tmpl));
+	memset(&c->tmpl.Q, 0, sizeof(c->tmpl.Q));
+	return c;
+}
+
+static void
+track_columns_free(track_columns_t *c)
+{
+	if (c->max) {
+		xfree(c->latitude);
+		xfree(c->longitude);
+		xfree(c->altitude);
+		xfree(c->creation_time);
+	}
+	if (c->microseconds) xfree(c->microseconds);
+	if (c->speed) xfree(c->speed);
+	if (c->course) xfree(c->course);
+	if (c->hdop) xfree(c->hdop);
+	if (c->fix) xfree(c->fix);
+	if (c->sat) xfree(c->sat);
+	if (c->heartrate) xfree(c->heartrate);
+	if (c->cadence) xfree(c->cadence);
+	xfree(c);
+}
+
+/*
+ * Append wpt.  Returns zero if wpt can't be reproduced exactly from the
+ * columns.
+ */
+static int
+track_columns_add(track_columns_t *c, const waypoint *wpt)
+{
+	const waypoint *t = &c->tmpl;
+	int i = c->count;
+	waypoint view;
+
+	if (c->count == c->max) {
+		c->max = c->max ? 2 * c->max : 256;
+		c->latitude = xrealloc(c->latitude, c->max * sizeof(*c->latitude));
+		c->longitude = xrealloc(c->longitude, c->max * sizeof(*c->longitude));
+		c->altitude = xrealloc(c->altitude, c->max * sizeof(*c->altitude));
+		c->creation_time = xrealloc(c->creation_time, c->max * sizeof(*c->creation_time));
+		COLUMN_GROW(c, microseconds);
+		COLUMN_GROW(c, speed);
+		COLUMN_GROW(c, course);
+		COLUMN_GROW(c, hdop);
+		COLUMN_GROW(c, fix);
+		COLUMN_GROW(c, sat);
+		COLUMN_GROW(c, heartrate);
+		COLUMN_GROW(c, cadence);
+	}
+
+	c->latitude[i] = wpt->latitude;
+	c->longitude[i] = wpt->longitude;
+	c->altitude[i] = wpt->altitude;
+	c->creation_time[i] = wpt->creation_time;
+	COLUMN_PUT(c, microseconds, i, wpt->microseconds, t->microseconds);
+	COLUMN_PUT(c, speed, i, flagged_float(wpt->wpt_flags.speed, wpt->speed),
+		flagged_float(t->wpt_flags.speed, t->speed));
+	COLUMN_PUT(c, course, i, flagged_float(wpt->wpt_flags.course, wpt->course),
+		flagged_float(t->wpt_flags.course, t->course));
+	COLUMN_PUT(c, hdop, i, wpt->hdop, t->hdop);
+	COLUMN_PUT(c, fix, i, (signed char) wpt->fix, (signed char) t->fix);
+	COLUMN_PUT(c, sat, i, (signed char) wpt->sat, (signed char) t->sat);
+	COLUMN_PUT(c, heartrate, i, wpt->heartrate, t->heartrate);
+	COLUMN_PUT(c, cadence, i, wpt->cadence, t->cadence);
+
+	track_columns_view(c, i, &view);
+	if (memcmp(&view.latitude, &wpt->latitude,
+	    sizeof(waypoint) - offsetof(waypoint, latitude)) != 0)
+		return 0;
+	c->count++;
+	return 1;
+}
+
+static track_columns_t *
+track_columns_copy(const track_columns_t *src)
+{
+	track_columns_t *c = xcalloc(1, sizeof(*c));
+
+	memcpy(&c->tmpl, &src->tmpl, sizeof(c->tmpl));
+	c->count = c->max = src->count;
+	c->latitude = xmalloc(c->max * sizeof(*c->latitude));
+	c->longitude = xmalloc(c->max * sizeof(*c->longitude));
+	c->altitude = xmalloc(c->max * sizeof(*c->altitude));
+	c->creation_time = xmalloc(c->max * sizeof(*c->creation_time));
+	memcpy(c->latitude, src->latitude, c->count * sizeof(*c->latitude));
+	memcpy(c->longitude, src->longitude, c->count * sizeof(*c->longitude));
+	memcpy(c->altitude, src->altitude, c->count * sizeof(*c->altitude));
+	memcpy(c->creation_time, src->creation_time, c->count * sizeof(*c->creation_time));
+	COLUMN_COPY(c, src, microseconds);
+	COLUMN_COPY(c, src, speed);
+	COLUMN_COPY(c, src, course);
+	COLUMN_COPY(c, src, hdop);
+	COLUMN_COPY(c, src, fix);
+	COLUMN_COPY(c, src, sat);
+	COLUMN_COPY(c, src, heartrate);
+	COLUMN_COPY(c, src, cadence);
+	return c;
+}
+
+static void
+track_compact(route_head *rte)
+{
+	queue *elem, *tmp;
+	track_columns_t *c;
+
+	if (rte->columns || QUEUE_EMPTY(&rte->waypoint_list)) return;
+
+	c = track_columns_new((waypoint *) QUEUE_FIRST(&rte->waypoint_list));
+	if (c == NULL) return;
+	QUEUE_FOR_EACH(&rte->waypoint_list, elem, tmp) {
+		if (!track_columns_add(c, (waypoint *) elem)) {
+			track_columns_free(c);
+			return;
+		}
+	}
+	waypt_flush(&rte->waypoint_list);
+	rte->columns = c;
+}
+
+static void
+track_expand(route_head *rte)
+{
+	track_columns_t *c = rte->columns;
+	int i;
+
+	if (c == NULL) return;
+	route_drop_name_index(rte);
+	for (i = 0; i < c->count; i++) {
+		waypoint *wpt = slab_alloc(session_waypt_slab(c->tmpl.session));
+		track_columns_view(c, i, wpt);
+		ENQUEUE_TAIL(&rte->waypoint_list, &wpt->Q);
+	}
+	rte->columns = NULL;
+	track_columns_free(c);
+}
+
+void
+track_compact_all(void)
+{
+	queue *elem, *tmp;
+
+	QUEUE_FOR_EACH(&my_track_head, elem, tmp) {
+		track_compact((route_head *) elem);
+	}
+}
+
+void
+track_expand_all(void)
+{
+	queue *elem, *tmp;
+
+	QUEUE_FOR_EACH(&my_track_head, elem, tmp) {
+		track_expand((route_head *) elem);
+	}
+	QUEUE_FOR_EACH(&my_route_head, elem, tmp) {
+		track_expand((route_head *) elem);
+	}
+}
+
+/*
+ * Writers whose callbacks only look at the waypoint they are given,
+ * and don't keep it, can take compact tracks as they are.
+ */
+void
+track_set_views(int ok)
+{
+	track_views = ok;
+}
+
+int
+track_get_views(void)
+{
+	return track_views;
+}
+
 void
 route_disp (const route_head *rh, waypt_cb cb )
 {
@@ -233,6 +570,16 @@ route_disp (const route_head *rh, waypt_cb cb )
 	if (!cb)  {
 		return;
 	}
+	if (rh->columns) {
+		/* two views, so that a callback may still look at the last point */
+		waypoint view[2];
+		int i;
+		for (i = 0; i < rh->columns->count; i++) {
+			track_columns_view(rh->columns, i, &view[i & 1]);
+			(*cb)(&view[i & 1]);
+		}
+		return;
+	}
 	QUEUE_FOR_EACH(&rh->waypoint_list, elem, tmp) {
 		waypoint *waypointp;
 		waypointp = (waypoint *) elem;
@@ -247,6 +594,7 @@ route_reverse(const route_head *rte_hd)
 	/* Cast away const-ness */
 	route_head *rh = (route_head *) rte_hd;
 	queue *elem, *tmp;
+	route_drop_name_index(rh);
 	QUEUE_FOR_EACH(&rh->waypoint_list, elem, tmp) {
 		ENQUEUE_HEAD(&rh->waypoint_list, dequeue(elem));
 	}
@@ -376,6 +724,11 @@ route_copy( int *dst_count, int *dst_wpt_count, queue **dst, queue *src ) {
 		rte_new->fs = fs_chain_copy( rte_old->fs );
 		rte_new->rte_num = rte_old->rte_num;
 		any_route_add_head( rte_new, *dst );
+		if ( rte_old->columns ) {
+			rte_new->columns = track_columns_copy( rte_old->columns );
+			rte_new->rte_waypt_ct = rte_old->columns->count;
+			*dst_wpt_count += rte_old->columns->count;
+		}
 		QUEUE_FOR_EACH( &rte_old->waypoint_list, elem2, tmp2 ) 
 		{
 			any_route_add_wpt( rte_new, waypt_dupe((waypoint *)elem2), dst_wpt_count, 0);
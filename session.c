@@ -25,7 +25,12 @@
 static queue session_list;
 static int session_ct;
 
+/* objects created before the first session is started */
+static slab_t waypt_slab;
+static slab_t route_slab;
+
 static void session_free(session_t *s);
+static void session_slab_init(slab_t *waypts, slab_t *routes);
 
 void
 session_init(void)
@@ -44,6 +49,8 @@ session_exit(void)
 		dequeue(&s->Q);
 		session_free(s);
 	}
+	slab_release(&waypt_slab);
+	slab_release(&route_slab);
 }
 
 void
@@ -60,6 +67,7 @@ start_session(const char *name, const char *filename)
 	s->nr = session_ct;
 	s->name = name;
 	s->filename = xstrdup(filename);
+	session_slab_init(&s->waypt_slab, &s->route_slab);
 }
 
 session_t *
@@ -68,6 +76,34 @@ curr_session(void)
 	return (session_t *) session_list.prev;
 }
 
+/*
+ * Waypoints and route heads are allocated from, and freed to, the slabs of
+ * the session they belong to.  Whatever is left is released in bulk when
+ * the session goes away.
+ */
+
+slab_t *
+session_waypt_slab(session_t *s)
+{
+	if ((s == NULL) || (&s->Q == &session_list)) s = NULL;
+	if (s == NULL) {
+		if (waypt_slab.size == 0) session_slab_init(&waypt_slab, &route_slab);
+		return &waypt_slab;
+	}
+	return &s->waypt_slab;
+}
+
+slab_t *
+session_route_slab(session_t *s)
+{
+	if ((s == NULL) || (&s->Q == &session_list)) s = NULL;
+	if (s == NULL) {
+		if (route_slab.size == 0) session_slab_init(&waypt_slab, &route_slab);
+		return &route_slab;
+	}
+	return &s->route_slab;
+}
+
 /* in work 
 
 int
@@ -111,7 +147,16 @@ session_free(session_t *s)
 		dequeue(&c->Q);
 		xfree(c);
 	}
+	slab_release(&s->waypt_slab);
+	slab_release(&s->route_slab);
 	xfree(s->filename);
 	xfree(s);
 }
 
+static void
+session_slab_init(slab_t *waypts, slab_t *routes)
+{
+	slab_init(waypts, sizeof(waypoint), 256);
+	slab_init(routes, sizeof(route_head), 32);
+}
+
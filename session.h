@@ -36,6 +36,8 @@ typedef struct {
 	int category_ct;
 	int unknown_category_ct;	/* added without id */
 	queue category_list;
+	slab_t waypt_slab;		/* waypoints read in this session */
+	slab_t route_slab;		/* route and track heads */
 } session_t;
 
 void session_init(void);
@@ -44,6 +46,9 @@ void session_exit(void);
 void start_session(const char *name, const char *filename);
 session_t *curr_session(void);
 
+slab_t *session_waypt_slab(session_t *s);
+slab_t *session_route_slab(session_t *s);
+
 /* in work
 int session_add_category(const char *name, const int id);
 */
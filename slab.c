@@ -0,0 +1,112 @@
+/*
+
+    Fixed size object allocator.
+    Copyright (C) 2009  Tom Payne, twpayne@gmail.com
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+
+#include "defs.h"
+
+#if defined(DEBUG_MEM) && !defined(NO_SLAB)
+#define NO_SLAB
+#endif
+
+/* Keep objects (and the block header) aligned for any member type. */
+typedef union {
+	void *p;
+	double d;
+	long l;
+} slab_align_t;
+
+#define SLAB_ROUND(n) \
+	(((n) + sizeof(slab_align_t) - 1) / sizeof(slab_align_t) * sizeof(slab_align_t))
+
+void
+slab_init(slab_t *slab, size_t size, int per_block)
+{
+	memset(slab, 0, sizeof(*slab));
+	if (size < sizeof(void *))
+		size = sizeof(void *);
+	slab->size = SLAB_ROUND(size);
+	slab->per_block = per_block;
+}
+
+void *
+slab_alloc(slab_t *slab)
+{
+	void *obj;
+
+	slab->count++;
+#ifdef NO_SLAB
+	return xcalloc(slab->size, 1);
+#else
+	if (slab->free_list) {
+		obj = slab->free_list;
+		slab->free_list = *(void **) obj;
+		memset(obj, 0, slab->size);
+		return obj;
+	}
+	if (slab->next == slab->end) {
+		size_t header = SLAB_ROUND(sizeof(slab_block_t));
+		slab_block_t *block = xmalloc(header + slab->per_block * slab->size);
+		block->next = slab->blocks;
+		slab->blocks = block;
+		slab->next = (char *) block + header;
+		slab->end = slab->next + slab->per_block * slab->size;
+	}
+	obj = slab->next;
+	slab->next += slab->size;
+	memset(obj, 0, slab->size);
+	return obj;
+#endif
+}
+
+void
+slab_free(slab_t *slab, void *obj)
+{
+	slab->count--;
+#ifdef NO_SLAB
+	xfree(obj);
+#else
+	/* once everything has been freed, give the blocks back */
+	if (slab->count == 0) {
+		slab_release(slab);
+		return;
+	}
+	*(void **) obj = slab->free_list;
+	slab->free_list = obj;
+#endif
+}
+
+/*
+ * Give back every block at once.  Objects still allocated from the slab
+ * become invalid; with NO_SLAB they are simply left to their owners.
+ */
+void
+slab_release(slab_t *slab)
+{
+	slab_block_t *block, *next;
+
+	for (block = slab->blocks; block; block = next) {
+		next = block->next;
+		xfree(block);
+	}
+	slab->blocks = NULL;
+	slab->next = slab->end = NULL;
+	slab->free_list = NULL;
+	slab->count = 0;
+}
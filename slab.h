@@ -0,0 +1,54 @@
+/*
+
+    Fixed size object allocator.
+    Copyright (C) 2009  Tom Payne, twpayne@gmail.com
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+
+#ifndef SLAB_H
+#define SLAB_H
+
+/*
+ * A slab hands out zeroed objects of a single size, carved from large
+ * blocks.  Freed objects are kept on a free list for reuse, and all the
+ * memory of a slab is given back at once by slab_release().
+ *
+ * Building with -DNO_SLAB (or -DDEBUG_MEM) makes every object a separate
+ * xcalloc() allocation, so that the two can be compared and so that
+ * memory debuggers see individual objects.
+ */
+
+typedef struct slab_block {
+	struct slab_block *next;
+} slab_block_t;
+
+typedef struct {
+	size_t size;		/* object size, rounded up for alignment */
+	int per_block;		/* objects per block */
+	slab_block_t *blocks;	/* all blocks, newest first */
+	char *next;		/* first unused object in newest block */
+	char *end;		/* end of newest block */
+	void *free_list;	/* freed objects, linked through first word */
+	unsigned int count;	/* objects currently allocated */
+} slab_t;
+
+void slab_init(slab_t *slab, size_t size, int per_block);
+void *slab_alloc(slab_t *slab);
+void slab_free(slab_t *slab, void *obj);
+void slab_release(slab_t *slab);
+
+#endif
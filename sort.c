@@ -66,6 +66,7 @@ sort_comp(const queue * a, const queue * b)
 void 
 sort_process(void)
 {
+	waypt_drop_name_index();
 	sortqueue(&waypt_head, sort_comp);
 }
 
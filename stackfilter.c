@@ -81,6 +81,8 @@ stackfilt_process(void)
 	queue tmp_queue;
 	unsigned int tmp_count;
 	
+	waypt_drop_name_index();
+
 	if ( opt_push ) {
 		tmp_elt = (struct stack_elt *)xmalloc(sizeof(struct stack_elt));
 		
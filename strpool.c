@@ -0,0 +1,237 @@
+/*
+
+    Shared, reference counted strings.
+    Copyright (C) 2009  Tom Payne, twpayne@gmail.com
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+
+/*
+ * Interned strings are kept once per distinct content, with a count of
+ * the references handed out.  They are packed into large chunks, so that
+ * any string can be passed to strpool_share() or strpool_release() and a
+ * search of the (few) chunk address ranges tells cheaply whether it is
+ * pooled or an ordinary heap string.  A chunk is freed when the last
+ * string in it is released.
+ *
+ * Pooled strings must never be modified in place or passed to xfree().
+ */
+
+#include <stddef.h>
+#include "defs.h"
+
+#define STRPOOL_CHUNK_SIZE (1024 * 1024)
+
+typedef struct strpool_entry {
+	struct strpool_entry *next;	/* same hash bucket */
+	struct strpool_chunk *chunk;
+	unsigned int hash;
+	unsigned int refs;
+	char str[1];
+} strpool_entry_t;
+
+typedef struct strpool_chunk {
+	char *start;
+	char *next;			/* unused space */
+	char *end;
+	unsigned int live;		/* entries still referenced */
+} strpool_chunk_t;
+
+static strpool_entry_t **buckets;
+static unsigned int nbuckets;		/* power of two */
+static unsigned int nentries;
+
+static strpool_chunk_t **chunks;	/* sorted by address */
+static int nchunks, max_chunks;
+static strpool_chunk_t *current;	/* chunk being filled */
+
+static unsigned int
+strpool_hash(const char *s)
+{
+	unsigned int h = 2166136261U;	/* FNV-1a */
+
+	while (*s) {
+		h ^= (unsigned char) *s++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static void
+strpool_grow(void)
+{
+	unsigned int n = nbuckets ? nbuckets * 2 : 1024;
+	strpool_entry_t **b = xcalloc(n, sizeof(*b));
+	unsigned int i;
+
+	for (i = 0; i < nbuckets; i++) {
+		strpool_entry_t *e, *next;
+		for (e = buckets[i]; e; e = next) {
+			next = e->next;
+			e->next = b[e->hash & (n - 1)];
+			b[e->hash & (n - 1)] = e;
+		}
+	}
+	if (buckets) xfree(buckets);
+	buckets = b;
+	nbuckets = n;
+}
+
+/* Index of the chunk containing s, or of the first chunk after it. */
+static int
+strpool_chunk_search(const char *s)
+{
+	int lo = 0, hi = nchunks;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (chunks[mid]->end <= s) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+static strpool_entry_t *
+strpool_find_addr(const char *s)
+{
+	int i;
+
+	/* heap strings usually lie well outside the range of the chunks */
+	if ((nchunks == 0) || (s < chunks[0]->start) || (s >= chunks[nchunks - 1]->end))
+		return NULL;
+	i = strpool_chunk_search(s);
+	if ((i == nchunks) || (s < chunks[i]->start)) return NULL;
+	return (strpool_entry_t *) (s - offsetof(strpool_entry_t, str));
+}
+
+static strpool_chunk_t *
+strpool_chunk_new(size_t size)
+{
+	strpool_chunk_t *c;
+	int i;
+
+	if (size < STRPOOL_CHUNK_SIZE) size = STRPOOL_CHUNK_SIZE;
+	c = xmalloc(sizeof(*c) + size);
+	c->start = c->next = (char *) (c + 1);
+	c->end = c->start + size;
+	c->live = 0;
+
+	if (nchunks == max_chunks) {
+		max_chunks = max_chunks ? max_chunks * 2 : 16;
+		chunks = xrealloc(chunks, max_chunks * sizeof(*chunks));
+	}
+	i = strpool_chunk_search(c->start);
+	memmove(chunks + i + 1, chunks + i, (nchunks - i) * sizeof(*chunks));
+	chunks[i] = c;
+	nchunks++;
+	return c;
+}
+
+static void
+strpool_chunk_free(strpool_chunk_t *c)
+{
+	int i = strpool_chunk_search(c->start);
+
+	memmove(chunks + i, chunks + i + 1, (nchunks - i - 1) * sizeof(*chunks));
+	nchunks--;
+	if (c == current) current = NULL;
+	xfree(c);
+}
+
+/*
+ * Return a pooled copy of s, sharing the existing one if the same
+ * string has already been interned.
+ */
+char *
+strpool_intern(const char *s)
+{
+	unsigned int hash;
+	strpool_entry_t *e;
+	size_t len, size;
+
+	if (s == NULL) return NULL;
+
+	hash = strpool_hash(s);
+	if (nentries) {
+		for (e = buckets[hash & (nbuckets - 1)]; e; e = e->next) {
+			if ((e->hash == hash) && (strcmp(e->str, s) == 0)) {
+				e->refs++;
+				return e->str;
+			}
+		}
+	}
+
+	if (nentries >= nbuckets) strpool_grow();
+
+	len = strlen(s);
+	size = offsetof(strpool_entry_t, str) + len + 1;
+	size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	if ((current == NULL) || ((size_t) (current->end - current->next) < size))
+		current = strpool_chunk_new(size);
+	e = (strpool_entry_t *) current->next;
+	current->next += size;
+	current->live++;
+
+	memcpy(e->str, s, len + 1);
+	e->chunk = current;
+	e->hash = hash;
+	e->refs = 1;
+	e->next = buckets[hash & (nbuckets - 1)];
+	buckets[hash & (nbuckets - 1)] = e;
+	nentries++;
+	return e->str;
+}
+
+/*
+ * Take another reference to s.  This costs no string work if s is
+ * already pooled; an ordinary string is interned.
+ */
+char *
+strpool_share(const char *s)
+{
+	strpool_entry_t *e;
+
+	if (s == NULL) return NULL;
+	if ((e = strpool_find_addr(s))) {
+		e->refs++;
+		return e->str;
+	}
+	return strpool_intern(s);
+}
+
+/*
+ * Drop a reference taken by strpool_intern() or strpool_share().  Strings
+ * that are not pooled are simply freed, so this can be used on any field
+ * that might hold either.
+ */
+void
+strpool_release(char *s)
+{
+	strpool_entry_t *e, **pe;
+
+	if (s == NULL) return;
+	if ((e = strpool_find_addr(s)) == NULL) {
+		xfree(s);
+		return;
+	}
+	if (--e->refs) return;
+
+	for (pe = &buckets[e->hash & (nbuckets - 1)]; *pe != e; pe = &(*pe)->next)
+		;
+	*pe = e->next;
+	nentries--;
+	if (--e->chunk->live == 0) strpool_chunk_free(e->chunk);
+}
@@ -0,0 +1,357 @@
+/*
+
+    Brauniger/Flytec instrument simulator.
+
+    Copyright (C) 2009  Tom Payne, twpayne@gmail.com
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+ */
+
+/*
+ * Opens a pseudo-terminal and answers the sentences sent by the flytec
+ * module from a recorded instrument image, so that the protocol can be
+ * tested and benchmarked without hardware.
+ *
+ * The image has the same format as the output of "-i flytec,debug": a line
+ * "> $PBRxxx,...*XX" starts the response to that sentence and each following
+ * line "< ..." is sent as part of the response, framed by XOFF and XON.
+ * Other lines are ignored.  Sentences that are not in the image, such as
+ * waypoint and route uploads, are acknowledged with XOFF XON, and uploaded
+ * waypoints are added to the PBRWPS response.
+ *
+ * usage: flytec-sim [-b baud] [-e n] [-t n] [-l link] image
+ *
+ *   -b baud   pace output as if on a serial line at this speed
+ *   -e n      corrupt the checksum of every nth NMEA sentence sent
+ *   -t n      do not respond to every nth sentence received
+ *   -l link   create a symbolic link to the pseudo-terminal
+ *
+ * The name of the pseudo-terminal is written to standard output.  The
+ * simulator runs until it is killed.
+ */
+
+#define _XOPEN_SOURCE 600
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+	XON = '\x11',
+	XOFF = '\x13',
+};
+
+typedef struct {
+	char *sentence;
+	int linec;
+	char **linev;
+} exchange_t;
+
+static int exchangec = 0;
+static exchange_t *exchangev = 0;
+static int baud = 0;
+static int error_every = 0;
+static int timeout_every = 0;
+static const char *link_name = 0;
+static int nmea_count = 0;
+static int sentence_count = 0;
+
+	static void
+die(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	fprintf(stderr, "flytec-sim: ");
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	exit(1);
+}
+
+	static void *
+xrealloc(void *p, size_t size)
+{
+	p = realloc(p, size);
+	if (!p)
+		die("realloc: %s\n", strerror(errno));
+	return p;
+}
+
+	static char *
+xstrdup(const char *s)
+{
+	char *result = strdup(s);
+	if (!result)
+		die("strdup: %s\n", strerror(errno));
+	return result;
+}
+
+	static int
+nmea_checksum(const char *p, const char *end)
+{
+	int checksum = 0;
+	for (; p != end; ++p)
+		checksum ^= (unsigned char) *p;
+	return checksum;
+}
+
+/* Strip the leading $ and trailing checksum from an NMEA sentence. */
+	static char *
+nmea_strip(char *s)
+{
+	if (*s != '$')
+		return 0;
+	char *star = strrchr(s, '*');
+	if (!star)
+		return 0;
+	*star = '\0';
+	return s + 1;
+}
+
+	static exchange_t *
+exchange_find(const char *sentence)
+{
+	int i;
+	for (i = 0; i < exchangec; ++i)
+		if (!strcmp(exchangev[i].sentence, sentence))
+			return &exchangev[i];
+	return 0;
+}
+
+	static exchange_t *
+exchange_new(const char *sentence)
+{
+	exchangev = xrealloc(exchangev, (exchangec + 1) * sizeof(exchange_t));
+	exchange_t *exchange = &exchangev[exchangec++];
+	exchange->sentence = xstrdup(sentence);
+	exchange->linec = 0;
+	exchange->linev = 0;
+	return exchange;
+}
+
+	static void
+exchange_add_line(exchange_t *exchange, const char *line)
+{
+	exchange->linev = xrealloc(exchange->linev, (exchange->linec + 1) * sizeof(char *));
+	exchange->linev[exchange->linec++] = xstrdup(line);
+}
+
+	static void
+image_read(const char *filename)
+{
+	FILE *file = fopen(filename, "r");
+	if (!file)
+		die("%s: %s\n", filename, strerror(errno));
+	exchange_t *exchange = 0;
+	char line[1024];
+	while (fgets(line, sizeof line, file)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '>' && line[1] == ' ') {
+			char *sentence = nmea_strip(line + 2);
+			if (!sentence)
+				die("%s: invalid sentence: %s\n", filename, line + 2);
+			/* only the first response to each sentence is used */
+			exchange = exchange_find(sentence) ? 0 : exchange_new(sentence);
+		} else if (line[0] == '<' && line[1] == ' ' && exchange) {
+			exchange_add_line(exchange, line + 2);
+		}
+	}
+	if (ferror(file))
+		die("%s: %s\n", filename, strerror(errno));
+	fclose(file);
+}
+
+	static void
+pty_write(int fd, const char *buf, int len)
+{
+	while (len > 0) {
+		/* pace output in chunks of about 10ms */
+		int n = baud ? baud / 1000 + 1 : len;
+		if (n > len)
+			n = len;
+		if (baud) {
+			struct timespec ts;
+			long ns = 10L * n * 1000000000L / baud;
+			ts.tv_sec = ns / 1000000000L;
+			ts.tv_nsec = ns % 1000000000L;
+			while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+				;
+		}
+		int rc = write(fd, buf, n);
+		if (rc == -1) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			die("write: %s\n", strerror(errno));
+		}
+		buf += rc;
+		len -= rc;
+	}
+}
+
+	static void
+respond_line(int fd, const char *line)
+{
+	char buf[1024];
+	int len = snprintf(buf, sizeof buf - 2, "%s", line);
+	if (len < 0 || len >= (int) sizeof buf - 2)
+		die("line too long: %s\n", line);
+	if (line[0] == '$' && error_every && ++nmea_count % error_every == 0) {
+		char *star = strrchr(buf, '*');
+		if (star && star[1])
+			star[1] = star[1] == '0' ? '1' : '0';
+	}
+	buf[len++] = '\r';
+	buf[len++] = '\n';
+	pty_write(fd, buf, len);
+}
+
+/* Remember an uploaded waypoint so that it is returned by PBRWPS. */
+	static void
+upload_waypoint(const char *sentence)
+{
+	exchange_t *exchange = exchange_find("PBRWPS,");
+	if (!exchange)
+		exchange = exchange_new("PBRWPS,");
+	char buf[1024];
+	int len = snprintf(buf, sizeof buf, "$PBRWPS,%s", sentence + strlen("PBRWPR,"));
+	if (len < 0 || len + 4 >= (int) sizeof buf)
+		die("sentence too long: %s\n", sentence);
+	snprintf(buf + len, sizeof buf - len, "*%02X", nmea_checksum(buf + 1, buf + len));
+	exchange_add_line(exchange, buf);
+}
+
+	static void
+respond(int fd, char *line)
+{
+	line[strcspn(line, "\r")] = '\0';
+	char *star = strrchr(line, '*');
+	if (line[0] != '$' || !star || strtol(star + 1, 0, 16) != nmea_checksum(line + 1, star))
+		return;
+	char *sentence = nmea_strip(line);
+	if (timeout_every && ++sentence_count % timeout_every == 0)
+		return;
+	char c = XOFF;
+	pty_write(fd, &c, 1);
+	exchange_t *exchange = exchange_find(sentence);
+	if (exchange) {
+		int i;
+		for (i = 0; i < exchange->linec; ++i)
+			respond_line(fd, exchange->linev[i]);
+	} else if (!strncmp(sentence, "PBRWPR,", 7)) {
+		upload_waypoint(sentence);
+	}
+	c = XON;
+	pty_write(fd, &c, 1);
+}
+
+	static void
+cleanup(void)
+{
+	if (link_name)
+		unlink(link_name);
+}
+
+	static void
+handle_signal(int signum)
+{
+	exit(0);
+}
+
+	int
+main(int argc, char *argv[])
+{
+	int opt;
+	while ((opt = getopt(argc, argv, "b:e:l:t:")) != -1) {
+		switch (opt) {
+			case 'b':
+				baud = atoi(optarg);
+				break;
+			case 'e':
+				error_every = atoi(optarg);
+				break;
+			case 'l':
+				link_name = optarg;
+				break;
+			case 't':
+				timeout_every = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-b baud] [-e n] [-t n] [-l link] image\n", argv[0]);
+				return 1;
+		}
+	}
+	if (optind + 1 != argc)
+		die("no image\n");
+	image_read(argv[optind]);
+
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fd == -1)
+		die("posix_openpt: %s\n", strerror(errno));
+	if (grantpt(fd) == -1 || unlockpt(fd) == -1)
+		die("grantpt: %s\n", strerror(errno));
+	const char *slave_name = ptsname(fd);
+	if (!slave_name)
+		die("ptsname: %s\n", strerror(errno));
+	/* keep the slave open so that reads do not fail between clients */
+	int slave_fd = open(slave_name, O_RDWR | O_NOCTTY);
+	if (slave_fd == -1)
+		die("open: %s: %s\n", slave_name, strerror(errno));
+	struct termios termios;
+	memset(&termios, 0, sizeof termios);
+	termios.c_iflag = IGNPAR;
+	termios.c_cflag = CLOCAL | CREAD | CS8;
+	if (tcsetattr(slave_fd, TCSANOW, &termios) == -1)
+		die("tcsetattr: %s\n", strerror(errno));
+
+	atexit(cleanup);
+	signal(SIGINT, handle_signal);
+	signal(SIGTERM, handle_signal);
+	if (link_name) {
+		unlink(link_name);
+		if (symlink(slave_name, link_name) == -1)
+			die("symlink: %s: %s\n", link_name, strerror(errno));
+	}
+	printf("%s\n", slave_name);
+	fflush(stdout);
+
+	char line[1024];
+	int len = 0;
+	while (1) {
+		char buf[256];
+		int n = read(fd, buf, sizeof buf);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			die("read: %s\n", strerror(errno));
+		}
+		int i;
+		for (i = 0; i < n; ++i) {
+			if (buf[i] == '\n') {
+				line[len] = '\0';
+				respond(fd, line);
+				len = 0;
+			} else if (buf[i] && len < (int) sizeof line - 1) {
+				line[len++] = buf[i];
+			}
+		}
+	}
+	return 0;
+}
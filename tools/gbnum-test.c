@@ -0,0 +1,523 @@
+/*
+
+    Check the number formatting and parsing of gbnum.c against the C library.
+
+    Copyright (C) 2009  Tom Payne, twpayne@gmail.com
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+ */
+
+/*
+ * gb_snprintf() and gb_strtod() must give exactly what snprintf() and
+ * strtod() give, as every text writer and many readers go through them.
+ * This compares them on
+ *
+ *   - every conversion used in the sources, with random and edge case
+ *     arguments and with output buffers that are too small,
+ *   - all the exact halfway cases of "%.Nf" for small denominators, and
+ *     the doubles right next to decimal halfway points,
+ *   - -0.0, values around 2^31, 2^53 and 1e15 to 1e22, infinities and NaN,
+ *   - random decimal strings, with and without signs, leading blanks,
+ *     exponents and trailing text.
+ *
+ * usage: gbnum-test [-v] [iterations]
+ *
+ * Nothing is printed unless a difference is found, in which case the exit
+ * status is 1.
+ */
+
+#include <float.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gbnum.h"
+
+/* gbnum.c falls back to these for the odd large conversion */
+void *
+xmalloc(size_t size)
+{
+	void *p = malloc(size);
+	if (!p) {
+		fprintf(stderr, "gbnum-test: out of memory\n");
+		exit(2);
+	}
+	return p;
+}
+
+void
+xfree(void *p)
+{
+	free(p);
+}
+
+/*
+ * The printf conversions found in the sources, as listed by
+ *   grep -ohE '%[-0 +#]*([0-9]+|\*)?(\.([0-9]+|\*))?(hh|h|ll|l)?[diouxXfFeEgGcs]'
+ */
+static const char *conversions[] = {
+	"%s", "%d", "%c", "%f", "%02d", "%lf", "%02x", "%.1f", "%*s", "%x",
+	"%ld", "%08.5f", "%g", "%.6f", "%2u", "%04x", "%04X", "%u", "%02X",
+	"%04d", "%lu", "%.0f", "%3.1f", "%03d", "%02u", "%.5f", "%.3f", "%.2f",
+	"%X", "%i", "%06.3f", "%.8lf", "%08x", "%.8x", "%09.3f", "%.15f",
+	"%08.3f", "%.*f", "%5.5x", "%3u", "%06d", "%0.6f", "%.7f", "%.2x",
+	"%-.50s", "%3.6f", "%05d", "%.10f", "%5.0f", "%2.2d", "%11.6f",
+	"%0.9f", "%0.8f", "%.8f", "%.2d", "%.20f", "%.12g", "%-18.18s",
+	"%lld", "%8X", "%7.0f", "%6.0f", "%5.1lf", "%4.3f", "%12.7f", "%1.1f",
+	"%0d", "%08X", "%011.5f", "%0.9lf", "%-8x", "%-8u", "%-20.20s",
+	"%-17s", "%llu", "%8.2f", "%6.5f", "%5lu", "%5d", "%4u", "%4d",
+	"%4.4d", "%3s", "%3d", "%2x", "%2s", "%2d", "%2.0f", "%11.4f",
+	"%11.3f", "%10.6f", "%0x", "%08lx", "%08.6f", "%07.0f", "%06X",
+	"%06.2f", "%05u", "%04.1f", "%03i", "%03.7f", "%010.3f", "%0.*f",
+	"%0*d", "%0*.*f", "%.9f", "%.6x", "%.6lf", "%.4s", "%-8.8s",
+	"%-50.50s", "%-16s", "%-.7f", "%-.4s", "%-.31s", "%*.*s", "%o",
+	"%li", "%le", "%e", "%9s", "%8.5lf", "%8.5f", "%6x", "%6s", "%6c",
+	"%5e", "%59s", "%5.5lx", "%4c", "%3.7f", "%3.0f", "%2X", "%1d",
+	"%16s", "%128s", "%12.2f", "%10.5f", "%10.2f", "%10.0f", "%1.0f",
+	"%09.4f", "%08.5lf", "%08.2f", "%07d", "%06x", "%05.0f", "%04u",
+	"%04ld", "%04.0f", "%03u", "%03ld", "%02ld", "%010.4f", "%0.1f",
+	"%.9lf", "%.8s", "%.80s", "%.6s", "%.4x", "%.3d", "%.2X", "%.25s",
+	"%.128s", "%.*s", "%-9s", "%-7.1f", "%-6s", "%-6.6s", "%-40.40s",
+	"%-4.4s", "%-30.30s", "%-.78s", "%-.46s", "%-.40s", "%-.24s",
+	"%-.20s", "%-.14s", "%-.*s", "%*.*f", "%lo",
+	NULL
+};
+
+static int verbose = 0;
+static int failures = 0;
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long
+rnd(void)
+{
+	/* xorshift64*, so that every run checks the same values */
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 2685821657736338717ULL;
+}
+
+static double
+bits_to_double(unsigned long long u)
+{
+	double d;
+	memcpy(&d, &u, sizeof(d));
+	return d;
+}
+
+static unsigned long long
+double_to_bits(double d)
+{
+	unsigned long long u;
+	memcpy(&u, &d, sizeof(u));
+	return u;
+}
+
+/* The double next to d, towards +inf if up and towards -inf otherwise. */
+static double
+next_double(double d, int up)
+{
+	unsigned long long u = double_to_bits(d);
+
+	if (d == 0.0) return up ? bits_to_double(1) : -bits_to_double(1);
+	if ((d > 0.0) == (up != 0)) u++;
+	else u--;
+	return bits_to_double(u);
+}
+
+static double
+random_double(void)
+{
+	unsigned long long r = rnd();
+	double d;
+
+	switch (r & 7) {
+	case 0:		/* anything, including infinities and NaN */
+		return bits_to_double(rnd());
+	case 1:		/* coordinates */
+		d = (double) (rnd() >> 11) / (double) (1ULL << 53) * 360.0 - 180.0;
+		break;
+	case 2:		/* elevations, speeds and such */
+		d = (double) (rnd() >> 11) / (double) (1ULL << 53) * 20000.0 - 1000.0;
+		break;
+	case 3:		/* a few decimals, as read from a file */
+		d = (double) (long long) (rnd() % 2000000001ULL - 1000000000ULL) /
+			(double) (1ULL << (rnd() % 20));
+		break;
+	case 4:		/* small magnitudes */
+		d = (double) (rnd() >> 11) / (double) (1ULL << 53) / (double) (1ULL << (rnd() % 40));
+		break;
+	case 5:		/* around 2^31 and 2^32 */
+		d = (double) (1ULL << (31 + (rnd() & 1))) + (double) ((long long) (rnd() % 2001) - 1000) / 4.0;
+		break;
+	case 6:		/* around 2^53 and the powers of ten near it */
+		d = (double) (1ULL << 53) * (double) (1 + (rnd() % 1000)) / 100.0;
+		break;
+	default:
+		d = (double) (long long) rnd();
+		break;
+	}
+	return (r & 8) ? -d : d;
+}
+
+static void
+report(const char *what, const char *fmt, const char *expect, int expect_n,
+	const char *got, int got_n, size_t size)
+{
+	if (++failures > 20) return;
+	fprintf(stderr, "gbnum-test: %s \"%s\" size %lu: C library \"%s\" (%d), gbnum \"%s\" (%d)\n",
+		what, fmt, (unsigned long) size, expect, expect_n, got, got_n);
+}
+
+/*
+ * Format with both, into a buffer of the right size and into ones that are
+ * too small.  The arguments are passed as a va_list to both.
+ */
+static void
+check_vformat(const char *fmt, ...)
+{
+	char expect[512], got[512];
+	size_t sizes[4];
+	int i, expect_n, got_n;
+	va_list ap, aq;
+
+	va_start(ap, fmt);
+	va_copy(aq, ap);
+	expect_n = vsnprintf(expect, sizeof(expect), fmt, aq);
+	va_end(aq);
+	sizes[0] = sizeof(got);
+	sizes[1] = 0;
+	sizes[2] = 1;
+	sizes[3] = (expect_n > 1) ? expect_n / 2 + 1 : 1;
+	for (i = 0; i < 4; i++) {
+		char e[512];
+		int en;
+
+		memset(e, '#', sizeof(e));
+		memset(got, '#', sizeof(got));
+		va_copy(aq, ap);
+		en = vsnprintf(e, sizes[i], fmt, aq);
+		va_end(aq);
+		va_copy(aq, ap);
+		got_n = gb_vsnprintf(got, sizes[i], fmt, aq);
+		va_end(aq);
+		if ((en != got_n) || memcmp(e, got, sizeof(e))) {
+			e[sizeof(e) - 1] = got[sizeof(got) - 1] = '\0';
+			report("format", fmt, (sizes[i] ? e : expect), en,
+				(sizes[i] ? got : "(none)"), got_n, sizes[i]);
+		}
+	}
+	va_end(ap);
+	if (verbose > 1) printf("%s: %s\n", fmt, expect);
+}
+
+static const char *strings[] = {
+	"", "a", "LAUNCH", "a somewhat longer string with spaces",
+	"0123456789012345678901234567890123456789012345678901234567890123456789"
+	"01234567890123456789012345678901234567890123456789",
+	"\xc3\xa4\xc3\xb6\xc3\xbc", NULL
+};
+
+/* One conversion with an argument of the type it needs. */
+static void
+check_conversion(const char *fmt)
+{
+	const char *p = fmt + 1;
+	int stars = 0, len = 0;
+	char conv;
+	int w = (int) (rnd() % 41) - 10, pr = (int) (rnd() % 24) - 2;
+
+	for (; *p && !strchr("diouxXfFeEgGcs", *p); p++) {
+		if (*p == '*') stars++;
+		if (*p == 'l') len++;
+		if (*p == 'h') len--;
+	}
+	conv = *p;
+
+	switch (conv) {
+	case 'd':
+	case 'i': {
+		static const long long edge[] = {
+			0, 1, -1, 9, 10, 99, -100, INT_MAX, INT_MIN, LLONG_MAX, LLONG_MIN
+		};
+		long long v = (rnd() & 1) ? edge[rnd() % 11] : (long long) rnd() >> (rnd() % 64);
+
+		if (len == 2) {
+			if (stars == 1) check_vformat(fmt, w, v);
+			else check_vformat(fmt, v);
+		}
+		else if (len == 1) {
+			if (stars == 1) check_vformat(fmt, w, (long) v);
+			else check_vformat(fmt, (long) v);
+		}
+		else {
+			if (stars == 1) check_vformat(fmt, w, (int) v);
+			else check_vformat(fmt, (int) v);
+		}
+		break;
+	}
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X': {
+		unsigned long long v = (rnd() & 1) ? rnd() % 300 : rnd() >> (rnd() % 64);
+
+		if (len == 2) check_vformat(fmt, v);
+		else if (len == 1) check_vformat(fmt, (unsigned long) v);
+		else check_vformat(fmt, (unsigned int) v);
+		break;
+	}
+	case 'c':
+		check_vformat(fmt, (int) (rnd() % 95 + 32));
+		break;
+	case 's': {
+		const char *s = strings[rnd() % 6];
+
+		if (stars == 2) check_vformat(fmt, w, pr, s);
+		else if (stars == 1) check_vformat(fmt, (strstr(fmt, ".*") ? pr : w), s);
+		else check_vformat(fmt, s);
+		break;
+	}
+	default: {	/* the floating point ones */
+		double d = random_double();
+
+		if (stars == 2) check_vformat(fmt, w, pr, d);
+		else if (stars == 1) check_vformat(fmt, (strstr(fmt, ".*") ? pr : w), d);
+		else check_vformat(fmt, d);
+		break;
+	}
+	}
+}
+
+/*
+ * All the exact halfway cases m / 2^k of "%.Nf" with k up to 10, each with
+ * its neighbours, and the doubles closest to decimal halfway points.
+ */
+static void
+check_ties(void)
+{
+	static const char *fixed[] = {
+		"%.0f", "%.1f", "%.2f", "%.3f", "%.4f", "%.5f", "%.6f", "%.7f",
+		"%.8f", "%.9f", NULL
+	};
+	int k, m, n;
+	const char **f;
+
+	for (k = 1; k <= 10; k++) {
+		for (m = -(1 << 11) + 1; m < (1 << 11); m += 2) {
+			double d = (double) m / (double) (1 << k);
+
+			for (f = fixed; *f; f++) {
+				check_vformat(*f, d);
+				check_vformat(*f, next_double(d, 0));
+				check_vformat(*f, next_double(d, 1));
+			}
+		}
+	}
+	for (n = 0; n < 20000; n++) {
+		int prec = (int) (rnd() % 10);
+		long long scale = 1;
+		double d;
+
+		for (k = 0; k < prec; k++) scale *= 10;
+		d = ((double) (long long) (rnd() % 100000000ULL) + 0.5) / (double) scale;
+		if (rnd() & 1) d = -d;
+		check_vformat(fixed[prec], d);
+		check_vformat(fixed[prec], next_double(d, 0));
+		check_vformat(fixed[prec], next_double(d, 1));
+	}
+}
+
+static void
+check_edges(void)
+{
+	static const double edge[] = {
+		0.0, 1.0, 0.5, 1.5, 2.5, 0.05, 0.005, 0.0005, 9.5, 99.5, 999.9995,
+		2147483647.0, 2147483647.5, 2147483648.0, 2147483648.5, 4294967295.5,
+		4294967296.5, 9007199254740991.0, 9007199254740992.0,
+		9007199254740993.0, 1e15, 1e15 + 0.5, 1e16, 1e17, 1e18, 1e21, 1e22,
+		1e23, DBL_MAX, DBL_MIN, DBL_EPSILON, 1e-7, 4e-7, 5e-7, 6e-7
+	};
+	static const char *fmts[] = {
+		"%f", "%.0f", "%.1f", "%.2f", "%.3f", "%.6f", "%.9f", "%.15f",
+		"%.20f", "%08.3f", "%-12.4f", "%012.1f", "%g", "%e", NULL
+	};
+	const char **f;
+	size_t i;
+
+	for (f = fmts; *f; f++) {
+		for (i = 0; i < sizeof(edge) / sizeof(edge[0]); i++) {
+			check_vformat(*f, edge[i]);
+			check_vformat(*f, -edge[i]);
+			check_vformat(*f, next_double(edge[i], 0));
+			check_vformat(*f, next_double(edge[i], 1));
+		}
+		check_vformat(*f, -0.0);
+		check_vformat(*f, -0.0004);		/* rounds to "-0.000" */
+		check_vformat(*f, bits_to_double(0x7FF0000000000000ULL));	/* inf */
+		check_vformat(*f, bits_to_double(0xFFF0000000000000ULL));	/* -inf */
+		check_vformat(*f, bits_to_double(0x7FF8000000000000ULL));	/* nan */
+		check_vformat(*f, bits_to_double(0xFFF8000000000000ULL));	/* -nan */
+	}
+	/* "%.*s" must not read past a string shorter than the precision */
+	{
+		char *s = xmalloc(3);
+
+		memcpy(s, "ab", 3);
+		check_vformat("%.*s", 1000, s);
+		check_vformat("[%.40s]", s);
+		check_vformat("[%-10.40s]", s);
+		xfree(s);
+	}
+	/* a whole line, as the writers use them */
+	check_vformat("%s,%.6f,%.6f,%.1f,%d,%c,%02d:%02d:%02d\n", "WPT001",
+		47.123456789, -122.987654321, 1234.55, 17, 'N', 9, 5, 7);
+}
+
+static void
+check_strtod_string(const char *s)
+{
+	char *expect_end, *got_end;
+	double expect = strtod(s, &expect_end);
+	double got = gb_strtod(s, &got_end);
+	const char *p;
+	double d = 0.0;
+	int ok;
+
+	if ((double_to_bits(expect) != double_to_bits(got)) || (expect_end != got_end)) {
+		if (++failures <= 20)
+			fprintf(stderr, "gbnum-test: strtod \"%s\": C library %.17g (+%d), gbnum %.17g (+%d)\n",
+				s, expect, (int) (expect_end - s), got, (int) (got_end - s));
+	}
+
+	/* gb_scan_dbl reads what strtod reads and nothing if that is nothing */
+	p = s;
+	ok = gb_scan_dbl(&p, &d);
+	if ((ok != (expect_end != s)) || (ok && ((p != expect_end) ||
+	    (double_to_bits(d) != double_to_bits(expect))))) {
+		if (++failures <= 20)
+			fprintf(stderr, "gbnum-test: gb_scan_dbl \"%s\" differs from strtod\n", s);
+	}
+}
+
+static void
+check_strtod(long iterations)
+{
+	static const char *edge[] = {
+		"", " ", "-", "+", ".", "-.", "0", "-0", "+0", "0.", ".0", "-0.0",
+		"00012.5000", "1.5e3", "1.5E-3", "0x1A", "0X1p3", "inf", "-Infinity",
+		"nan", "  42", "\t-7.25", "12abc", "12.34.56", "1,5", "9007199254740992",
+		"9007199254740993", "9007199254740993.5", "123456789012345678901234567890",
+		"0.0000000000000000000001", "0.00000000000000000000001",
+		"1.2345678901234567890123", "179769313486231570000000000000000000000000",
+		"4.9e-324", "2147483648.5", "-2147483648.25", "47.6062095", "-122.3320708",
+		NULL
+	};
+	const char **e;
+	long n;
+
+	for (e = edge; *e; e++) check_strtod_string(*e);
+
+	for (n = 0; n < iterations; n++) {
+		char buf[96];
+		char *p = buf;
+		int digits = 1 + (int) (rnd() % 22), decimals = (int) (rnd() % 26);
+		int i;
+
+		if ((rnd() % 8) == 0) *p++ = ' ';
+		switch (rnd() % 4) {
+		case 0: *p++ = '-'; break;
+		case 1: *p++ = '+'; break;
+		}
+		for (i = 0; i < digits; i++) *p++ = '0' + (char) (rnd() % 10);
+		if (decimals || (rnd() & 1)) *p++ = '.';
+		for (i = 0; i < decimals; i++) *p++ = '0' + (char) (rnd() % 10);
+		switch (rnd() % 8) {
+		case 0:
+			p += sprintf(p, "e%d", (int) (rnd() % 40) - 20);
+			break;
+		case 1:
+			p += sprintf(p, ",N");
+			break;
+		case 2:
+			*p++ = '*';
+			break;
+		}
+		*p = '\0';
+		check_strtod_string(buf);
+	}
+}
+
+static void
+check_scan_int(void)
+{
+	static const struct {
+		const char *s;
+		int len;
+		int ok;
+		int val;
+	} cases[] = {
+		{ "0", 1, 1, 0 }, { "09", 2, 1, 9 }, { "2359", 4, 1, 2359 },
+		{ "-05", 3, 1, -5 }, { "+12", 3, 1, 12 }, { "1a", 2, 0, 0 },
+		{ " 1", 2, 0, 0 }, { "-", 1, 0, 0 }, { "123456", 3, 1, 123 },
+		{ NULL, 0, 0, 0 }
+	};
+	int i;
+
+	for (i = 0; cases[i].s; i++) {
+		int val = 0;
+		int ok = gb_scan_int(cases[i].s, cases[i].len, &val);
+
+		if ((ok != cases[i].ok) || (ok && (val != cases[i].val))) {
+			if (++failures <= 20)
+				fprintf(stderr, "gbnum-test: gb_scan_int \"%s\" %d: got %d %d\n",
+					cases[i].s, cases[i].len, ok, val);
+		}
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	long iterations = 100000;
+	long n;
+	int count;
+	const char **c;
+
+	while ((argc > 1) && !strcmp(argv[1], "-v")) {
+		verbose++;
+		argc--;
+		argv++;
+	}
+	if (argc > 1) iterations = atol(argv[1]);
+
+	for (count = 0; conversions[count]; count++);
+	for (n = 0; n < iterations; n++) check_conversion(conversions[n % count]);
+	for (c = conversions; *c; c++) check_conversion(*c);
+	check_ties();
+	check_edges();
+	check_strtod(iterations);
+	check_scan_int();
+
+	if (failures) {
+		fprintf(stderr, "gbnum-test: %d differences\n", failures);
+		return 1;
+	}
+	if (verbose) printf("gbnum-test: no differences\n");
+	return 0;
+}
@@ -561,7 +561,7 @@ void tpo_process_tracks(void)
         char *track_name;
         unsigned int track_byte_count;
         int llvalid;
-        unsigned char *buf;
+        const unsigned char *buf;
         int lonscale;
         int latscale;
         int waypoint_count = 0;
@@ -616,9 +616,9 @@ void tpo_process_tracks(void)
         // we've read.  We need to do this so that we start at the
         // proper place for the next track.
 
-        // Read the track bytes into a buffer
-        buf = xmalloc(track_byte_count);
-        gbfread(buf, 1, track_byte_count, tpo_file_in);
+        // Decode the track bytes where they are in the file buffer
+        buf = gbfreadptr(tpo_file_in, track_byte_count);
+        is_fatal(buf == NULL, MYNAME ": Unexpected end of file!\n");
 
         latscale=0;
         lonscale=0;
@@ -714,7 +714,6 @@ void tpo_process_tracks(void)
         }
         track_temp->rte_waypt_ct = waypoint_count;
 	
-        xfree(buf);
     }
 //printf("\n");
 }
@@ -1254,11 +1253,7 @@ void tpo_process_routes(void)
 
     // Free the waypoint index, we don't need it anymore.
     for (ii = 0; ii < tpo_index_ptr; ii++) {
-        if (tpo_wp_index[ii]->shortname)
-            xfree(tpo_wp_index[ii]->shortname);
-        if (tpo_wp_index[ii]->description)
-            xfree(tpo_wp_index[ii]->description);
-        xfree(tpo_wp_index[ii]);
+        waypt_free(tpo_wp_index[ii]);
     }
 
     // Free the index array itself
@@ -599,7 +599,7 @@ unicsv_rd_init(const char *fname)
 
 	fin = gbfopen(fname, "rb", MYNAME);
 
-	if ((c = gbfgetstr(fin)))
+	if ((c = gbfgetline(fin)))
 		unicsv_fondle_header(c);
 	else
 		unicsv_fieldsep = NULL;
@@ -1118,7 +1118,7 @@ unicsv_rd(void)
 
 	if (unicsv_fieldsep == NULL) return;
 
-	while ((buff = gbfgetstr(fin))) {
+	while ((buff = gbfgetline(fin))) {
 	    	buff = lrtrim(buff);
 		if ((*buff == '\0') || (*buff == '#')) continue;
 		unicsv_parse_one_line(buff);
@@ -1576,6 +1576,7 @@ static void
 unicsv_wr_init(const char *filename)
 {
 	fout = gbfopen(filename, "wb", MYNAME);
+	track_set_views(1);
 
 	memset(&unicsv_outp_flags, 0, sizeof(unicsv_outp_flags));
 	unicsv_grid_idx = grid_unknown;
@@ -1564,97 +1564,59 @@ entity_types stdentities[] =  {
 	{ NULL,	NULL, 0 }
 };
 
+static const entity_types *
+entity_for(const char c, int is_html)
+{
+	const entity_types *ep;
+
+	for (ep = stdentities; ep->text; ep++) {
+		if ((ep->text[0] == c) && !(is_html && ep->not_html)) {
+			return ep;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Replace the characters of stdentities by their entities in a single
+ * pass; all of them are one character and no entity contains another,
+ * so this is the same as replacing one kind after the other.
+ */
 static 
 char * 
 entitize(const char * str, int is_html) 
 {
-	int elen, ecount, nsecount;
-	entity_types *ep;
+	const entity_types *ep;
 	const char * cp;
-	char * p, * tmp, * xstr;
-
-	int bytes = 0;
-	int value = 0;
-	ep = stdentities;
-	elen = ecount = nsecount = 0;
-
-	/* figure # of entity replacements and additional size. */
-	while (ep->text) {
-		cp = str;
-		while ((cp = strstr(cp, ep->text)) != NULL) {
-			elen += strlen(ep->entity) - strlen(ep->text);
-			ecount++;
-			cp += strlen(ep->text);
-		}
-		ep++;
-	}
-	
-	/* figure the same for other than standard entities (i.e. anything
-	 * that isn't in the range U+0000 to U+007F */
-	
-#if 0
-	for ( cp = str; *cp; cp++ ) {
-		if ( *cp & 0x80 ) {
-			cet_utf8_to_ucs4( cp, &bytes, &value );
-			cp += bytes-1;
-			elen += sprintf( tmpsub, "&#x%x;", value ) - bytes;
-		        nsecount++;	
-		}
-	}
-#endif
-
-	/* enough space for the whole string plus entity replacements, if any */
-	tmp = xcalloc((strlen(str) + elen + 1), 1);
-	strcpy(tmp, str);
+	char * p, * tmp;
+	size_t len = 0;
 
 	/* no entity replacements */
-	if (ecount == 0 && nsecount == 0)
-		return (tmp);
-
-        if ( ecount != 0 ) {	
-		for (ep = stdentities; ep->text; ep++) {
-			p = tmp;
-			if (is_html && ep->not_html)  {
-				continue;
-			}
-			while ((p = strstr(p, ep->text)) != NULL) {
-				elen = strlen(ep->entity);
-
-				xstr = xstrdup(p + strlen(ep->text));
+	if (strpbrk(str, is_html ? "&<>\"" : "&'<>\"") == NULL) {
+		return xstrdup(str);
+	}
 
-				strcpy(p, ep->entity);
-				strcpy(p + elen, xstr);
+	/* figure the size with the entity replacements */
+	for (cp = str; *cp; cp++) {
+		ep = entity_for(*cp, is_html);
+		len += ep ? strlen(ep->entity) : 1;
+	}
 
-				xfree(xstr);
+	tmp = p = xmalloc(len + 1);
+	for (cp = str; *cp; cp++) {
+		ep = entity_for(*cp, is_html);
+		if (ep) {
+			size_t elen = strlen(ep->entity);
 
-				p += elen;
-			}  
+			memcpy(p, ep->entity, elen);
+			p += elen;
+		}
+		else {
+			*p++ = *cp;
 		}
 	}
+	*p = '\0';
 
-	if ( nsecount != 0 ) {
-		p = tmp;
-		while (*p) {
-			if ( *p & 0x80 ) {
-				cet_utf8_to_ucs4( p, &bytes, &value );
-				if ( p[bytes] ) {
-					xstr = xstrdup( p + bytes );
-				}
-				else {
-					xstr = NULL;
-				}
-				sprintf( p, "&#x%x;", value );
-				p = p+strlen(p);
-				if ( xstr ) {
-					strcpy( p, xstr );
-					xfree(xstr);
-				}
-			}
-			else {
-				p++;
-			}
-		}
-	}	
 	return (tmp);
 }
 
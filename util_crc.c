@@ -94,3 +94,19 @@ get_crc32_s(const void *data)
 	}
 	return (crc ^ 0xFFFFFFFF);
 }
+
+/*
+ * CRC of the data that gave crc followed by the null-terminated string
+ * data, so a hash over a growing string needs only the new part.
+ */
+unsigned long
+get_crc32_s_append(unsigned long crc, const void *data)
+{
+	const unsigned char* cp = (unsigned char *)data;
+
+	crc ^= 0xFFFFFFFF;
+	for (;*cp;cp++) {
+		crc = ((crc >> 8) & 0x00FFFFFF) ^ crc32_table[(crc ^ *cp) &0xFF];
+	}
+	return (crc ^ 0xFFFFFFFF);
+}
@@ -1129,7 +1129,7 @@ find_vec(char *const vecname, char **opts)
 		if (global_opts.debug_level >= 1)
 			disp_vec_options(svec->name, vec_list[0].vec->args);
 #if CSVFMTS_ENABLED		
-		xcsv_setup_internal_style(svec->style_buf);
+		xcsv_setup_internal_style(svec->style);
 #endif // CSVFMTS_ENABLED		
 
 		xfree(v);
@@ -1244,19 +1244,18 @@ sort_and_unify_vecs(int *ctp)
 	}
 
 #if CSVFMTS_ENABLED
-	/* Walk the style list, parse the entries, dummy up a "normal" vec */
+	/* Walk the style list, dummy up a "normal" vec from each entry */
 	for (svec = style_list; svec->name; svec++, i++)  {
-		xcsv_read_internal_style(svec->style_buf);
 		svp[i] = xcalloc(1, sizeof **svp);
 		svp[i]->name = svec->name;
 		svp[i]->vec = xmalloc(sizeof(*svp[i]->vec));
-		svp[i]->extension = xcsv_file.extension;
+		svp[i]->extension = svec->style->extension;
 		*svp[i]->vec = *vec_list[0].vec; /* Interits xcsv opts */
 		/* Reset file type to inherit ff_type from xcsv for everything
 		 * except the xcsv format itself, which we leave as "internal"
 		 */
 		if (case_ignore_strcmp(svec->name, "xcsv")) {
-			svp[i]->vec->type = xcsv_file.type;
+			svp[i]->vec->type = svec->style->type;
 			/* Skip over the first help entry for all but the
 			 * actual 'xcsv' format - so we don't expose the
 			 * 'full path to xcsv style file' argument to any
@@ -1265,7 +1264,7 @@ sort_and_unify_vecs(int *ctp)
 			svp[i]->vec->args++;
 		}
 		memset(&svp[i]->vec->cap, 0, sizeof(svp[i]->vec->cap));
-		switch(xcsv_file.datatype) {
+		switch(svec->style->datatype) {
 			case 0:
 			case wptdata:
 				svp[i]->vec->cap[ff_cap_rw_wpt] = ff_cap_read | ff_cap_write; break;
@@ -1275,7 +1274,7 @@ sort_and_unify_vecs(int *ctp)
 				svp[i]->vec->cap[ff_cap_rw_rte] = ff_cap_read | ff_cap_write; break;
 			default: ;
 		}
-		svp[i]->desc = xcsv_file.description;
+		svp[i]->desc = svec->style->description;
 		svp[i]->parent = "xcsv";
 	}
 #endif // CSVFMTS_ENABLED
@@ -20,6 +20,7 @@
  */
 
 #include <stdio.h>
+#include <ctype.h>
 #include "defs.h"
 #include "cet_util.h"
 #include "grtcirc.h"
@@ -31,6 +32,8 @@ static unsigned int waypt_ct;
 static short_handle mkshort_handle;
 int geocaches_present;
 static geocache_data empty_gc_data = { 0 };
+static waypt_index_t *waypt_indexes;		/* all live name indexes */
+static waypt_index_t *waypt_name_index;		/* index of waypt_head */
 
 void
 waypt_init(void)
@@ -48,20 +51,20 @@ waypt_dupe(const waypoint *wpt)
 	waypoint * tmp;
 	url_link *url_next;
 
-	tmp = waypt_new();
+	/* the copy lives in the same session, and so the same slab */
+	tmp = slab_alloc(session_waypt_slab(wpt->session));
 	memcpy(tmp, wpt, sizeof(waypoint));
 	tmp->url_next = NULL;
 
-	if (wpt->shortname)
-		tmp->shortname = xstrdup(wpt->shortname);
-	if (wpt->description)
-		tmp->description = xstrdup(wpt->description);
-	if (wpt->notes)
-		tmp->notes = xstrdup(wpt->notes);
-	if (wpt->url)
-		tmp->url = xstrdup(wpt->url);
-	if (wpt->url_link_text)
-		tmp->url_link_text = xstrdup(wpt->url_link_text);
+	/*
+	 * The copy shares the text of pooled fields and interns the others;
+	 * the original keeps its strings as they are.
+	 */
+	tmp->shortname = strpool_share(wpt->shortname);
+	tmp->description = strpool_share(wpt->description);
+	tmp->notes = strpool_share(wpt->notes);
+	tmp->url = strpool_share(wpt->url);
+	tmp->url_link_text = strpool_share(wpt->url_link_text);
 	for (url_next = wpt->url_next; url_next; url_next = url_next->url_next) {
 		waypt_add_url(tmp,
 			(url_next->url) ? xstrdup(url_next->url) : NULL,
@@ -136,9 +139,9 @@ waypt_add(waypoint *wpt)
 	 */
 	if (wpt->shortname == NULL) {
 		if (wpt->description) {
-			wpt->shortname = xstrdup(wpt->description);
+			wpt->shortname = strpool_intern(wpt->description);
 		} else if (wpt->notes) {
-			wpt->shortname = xstrdup(wpt->notes);
+			wpt->shortname = strpool_intern(wpt->notes);
 		} else {
 		/* Last ditch:  make up a name */
 			char cbuf[10];
@@ -149,12 +152,12 @@ waypt_add(waypoint *wpt)
 
 	if (wpt->description == NULL || strlen(wpt->description) == 0) {
 		if (wpt->description)
-			xfree(wpt->description);
+			strpool_release(wpt->description);
 		if (wpt->notes != NULL) {
-			wpt->description = xstrdup(wpt->notes);
+			wpt->description = strpool_share(wpt->notes);
 		} else  {
 			if (wpt->shortname != NULL) {
-				wpt->description = xstrdup(wpt->shortname);
+				wpt->description = strpool_share(wpt->shortname);
 			}
 		}
 	}
@@ -168,6 +171,10 @@ waypt_add(waypoint *wpt)
 	if (wpt->gc_data->diff && wpt->gc_data->terr) {
 		geocaches_present = 1;
 	}
+
+	if (waypt_name_index) {
+		waypt_index_add(waypt_name_index, wpt);
+	}
 }
 
 void
@@ -175,6 +182,9 @@ waypt_del(waypoint *wpt)
 {
 	dequeue(&wpt->Q);
 	waypt_ct--;
+	if (waypt_name_index) {
+		waypt_index_del(waypt_name_index, wpt);
+	}
 }
 
 /*
@@ -185,7 +195,7 @@ waypt_new(void)
 {
 	waypoint *wpt;
 
-	wpt = (waypoint *) xcalloc(sizeof (*wpt), 1);
+	wpt = (waypoint *) slab_alloc(session_waypt_slab(curr_session()));
 #ifdef DEBUG_MEM
 	wpt->altitude = unknown_alt;
 	wpt->longitude = unknown_alt;
@@ -334,15 +344,211 @@ waypt_compute_bounds(bounds *bounds)
 	}
 }
 
+/*
+ * Name index.
+ *
+ * A waypt_index_t maps waypoint short names to waypoints so that readers
+ * which resolve route points by name do not have to scan a whole list for
+ * each one.  Names are hashed case-insensitively, so the same index answers
+ * both exact and case-insensitive lookups.  Each entry is also chained by
+ * the address of its waypoint, so a waypoint can be removed even after it
+ * has been renamed; an entry whose waypoint was renamed is simply never
+ * matched again.  Every live index forgets a waypoint when it is freed.
+ */
+
+typedef struct waypt_index_entry {
+	struct waypt_index_entry *name_next;
+	struct waypt_index_entry *addr_next;
+	waypoint *wpt;
+	unsigned int hash;
+} waypt_index_entry_t;
+
+struct waypt_index {
+	waypt_index_entry_t **by_name;
+	waypt_index_entry_t **by_addr;
+	unsigned int size;		/* buckets in each table, a power of two */
+	unsigned int count;
+	slab_t entries;
+	waypt_index_t *next;		/* next live index */
+};
+
+static unsigned int
+waypt_index_hash_name(const char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*name) {
+		hash = (hash ^ toupper((unsigned char) *name++)) * 16777619U;
+	}
+	return hash;
+}
+
+static unsigned int
+waypt_index_hash_addr(const waypoint *wpt)
+{
+	unsigned long a = (unsigned long) wpt;
+
+	return (unsigned int) ((a >> 4) ^ (a >> 16));
+}
+
+static void
+waypt_index_link(waypt_index_t *idx, waypt_index_entry_t *e)
+{
+	waypt_index_entry_t **p;
+
+	/* Append, so that of several waypoints with one name the first wins. */
+	for (p = &idx->by_name[e->hash & (idx->size - 1)]; *p; p = &(*p)->name_next)
+		;
+	*p = e;
+	e->name_next = NULL;
+
+	p = &idx->by_addr[waypt_index_hash_addr(e->wpt) & (idx->size - 1)];
+	e->addr_next = *p;
+	*p = e;
+}
+
+static void
+waypt_index_grow(waypt_index_t *idx)
+{
+	waypt_index_entry_t **by_name = idx->by_name;
+	unsigned int i, size = idx->size;
+
+	idx->size = size ? size * 2 : 256;
+	idx->by_name = xcalloc(idx->size, sizeof(*idx->by_name));
+	xfree(idx->by_addr);
+	idx->by_addr = xcalloc(idx->size, sizeof(*idx->by_addr));
+
+	for (i = 0; i < size; i++) {
+		waypt_index_entry_t *e, *next;
+		for (e = by_name[i]; e; e = next) {
+			next = e->name_next;
+			waypt_index_link(idx, e);
+		}
+	}
+	if (by_name) {
+		xfree(by_name);
+	}
+}
+
+waypt_index_t *
+waypt_index_new(void)
+{
+	waypt_index_t *idx = xcalloc(1, sizeof(*idx));
+
+	slab_init(&idx->entries, sizeof(waypt_index_entry_t), 1024);
+	waypt_index_grow(idx);
+	idx->next = waypt_indexes;
+	waypt_indexes = idx;
+	return idx;
+}
+
+void
+waypt_index_free(waypt_index_t *idx)
+{
+	waypt_index_t **p;
+
+	for (p = &waypt_indexes; *p; p = &(*p)->next) {
+		if (*p == idx) {
+			*p = idx->next;
+			break;
+		}
+	}
+	slab_release(&idx->entries);
+	xfree(idx->by_name);
+	xfree(idx->by_addr);
+	xfree(idx);
+}
+
+void
+waypt_index_add(waypt_index_t *idx, waypoint *wpt)
+{
+	waypt_index_entry_t *e;
+
+	if (wpt->shortname == NULL) return;
+
+	if (idx->count >= idx->size) {
+		waypt_index_grow(idx);
+	}
+	e = slab_alloc(&idx->entries);
+	e->wpt = wpt;
+	e->hash = waypt_index_hash_name(wpt->shortname);
+	waypt_index_link(idx, e);
+	idx->count++;
+}
+
+void
+waypt_index_del(waypt_index_t *idx, const waypoint *wpt)
+{
+	waypt_index_entry_t **p, *e;
+
+	for (p = &idx->by_addr[waypt_index_hash_addr(wpt) & (idx->size - 1)]; *p; p = &(*p)->addr_next) {
+		if ((*p)->wpt == wpt) break;
+	}
+	if ((e = *p) == NULL) return;
+	*p = e->addr_next;
+
+	for (p = &idx->by_name[e->hash & (idx->size - 1)]; *p != e; p = &(*p)->name_next)
+		;
+	*p = e->name_next;
+
+	slab_free(&idx->entries, e);
+	idx->count--;
+}
+
 waypoint *
-find_waypt_by_name(const char *name)
+waypt_index_find(const waypt_index_t *idx, const char *name, int ignore_case)
+{
+	unsigned int hash = waypt_index_hash_name(name);
+	waypt_index_entry_t *e;
+
+	for (e = idx->by_name[hash & (idx->size - 1)]; e; e = e->name_next) {
+		const char *shortname;
+		if (e->hash != hash) continue;
+		shortname = e->wpt->shortname;
+		if (shortname == NULL) continue;
+		if (ignore_case ? !case_ignore_strcmp(shortname, name) : !strcmp(shortname, name)) {
+			return e->wpt;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * The index of the global waypoint list is built by the first lookup and
+ * kept up to date by waypt_add() and waypt_del().  Anything that rearranges
+ * the list wholesale must drop it.
+ */
+void
+waypt_drop_name_index(void)
+{
+	if (waypt_name_index) {
+		waypt_index_free(waypt_name_index);
+		waypt_name_index = NULL;
+	}
+}
+
+static waypoint *
+waypt_find_by_name(const char *name, int ignore_case)
 {
 	queue *elem, *tmp;
 	waypoint *waypointp;
 
+	if (waypt_name_index == NULL) {
+		waypt_name_index = waypt_index_new();
+		QUEUE_FOR_EACH(&waypt_head, elem, tmp) {
+			waypt_index_add(waypt_name_index, (waypoint *) elem);
+		}
+	}
+	waypointp = waypt_index_find(waypt_name_index, name, ignore_case);
+	if (waypointp) {
+		return waypointp;
+	}
+
+	/* A waypoint may have been renamed since it was indexed. */
 	QUEUE_FOR_EACH(&waypt_head, elem, tmp) {
 		waypointp = (waypoint *) elem;
-		if (0 == strcmp(waypointp->shortname, name)) {
+		if (waypointp->shortname == NULL) continue;
+		if (ignore_case ? !case_ignore_strcmp(waypointp->shortname, name) : !strcmp(waypointp->shortname, name)) {
 			return waypointp;
 		}
 	}
@@ -350,27 +556,34 @@ find_waypt_by_name(const char *name)
 	return NULL;
 }
 
+waypoint *
+find_waypt_by_name(const char *name)
+{
+	return waypt_find_by_name(name, 0);
+}
+
+waypoint *
+find_waypt_by_name_ignore_case(const char *name)
+{
+	return waypt_find_by_name(name, 1);
+}
+
 void 
 waypt_free( waypoint *wpt )
 {
+	waypt_index_t *idx;
+
 	/*
 	 * This and waypt_dupe should be closely synced.
 	 */
-	if (wpt->shortname) {
-		xfree(wpt->shortname);
-	}
-	if (wpt->description) {
-		xfree(wpt->description);
-	}
-	if (wpt->notes) {
-		xfree(wpt->notes);
-	}
-	if (wpt->url) {
-		xfree(wpt->url);
-	}
-	if (wpt->url_link_text) {
-		xfree(wpt->url_link_text);
+	for (idx = waypt_indexes; idx; idx = idx->next) {
+		waypt_index_del(idx, wpt);
 	}
+	strpool_release(wpt->shortname);
+	strpool_release(wpt->description);
+	strpool_release(wpt->notes);
+	strpool_release(wpt->url);
+	strpool_release(wpt->url_link_text);
 	if (wpt->url_next) {
 		url_link *url_next;
 		
@@ -409,7 +622,7 @@ waypt_free( waypoint *wpt )
 		xfree(gc_data);
 	}
 	fs_chain_destroy( wpt->fs );
-	xfree(wpt);	
+	slab_free(session_waypt_slab(wpt->session), wpt);
 }
 
 void 
@@ -417,6 +630,9 @@ waypt_flush( queue *head )
 {
 	queue *elem, *tmp;
 
+	if (head == &waypt_head) {
+		waypt_drop_name_index();
+	}
 	QUEUE_FOR_EACH(head, elem, tmp) {
 		waypoint *q = (waypoint *) dequeue(elem);
 		waypt_free(q);
@@ -442,6 +658,7 @@ waypt_backup(signed int *count, queue **head_bak)
 	waypoint *wpt;
 	int no = 0;
 
+	waypt_drop_name_index();
 	qbackup = (queue *) xcalloc(1, sizeof(*qbackup));
 	QUEUE_INIT(qbackup);
 	
@@ -41,7 +41,7 @@ char *prefer_shortnames = NULL;
 char *xcsv_urlbase = NULL;
 static char *opt_datum;
 
-static const char *intstylebuf = NULL;
+static const xcsv_style_t *intstyle = NULL;
 
 static
 arglist_t xcsv_args[] = {
@@ -183,9 +183,119 @@ xcsv_get_char_from_constant_table(char *key)
 
     return (cm->chars);
 }
+/*
+ * Compiled styles.  The internal styles are compiled into tables by
+ * mkstyle.sh when gpsbabel is built; style files given with the
+ * "style" option are compiled by the parser below the first time
+ * they are used and are kept until exit.
+ */
+typedef struct xcsv_style_cache {
+	struct xcsv_style_cache *next;
+	char *fname;
+	xcsv_style_t *style;
+} xcsv_style_cache_t;
+
+static xcsv_style_cache_t *style_cache = NULL;
+
+static xcsv_style_t *
+xcsv_style_new(void)
+{
+	xcsv_style_t *style = xcalloc(sizeof(*style), 1);
+
+	style->type = ff_type_file;
+	style->shortlen = -1;
+	style->shortwhite = -1;
+	return style;
+}
+
+static void
+xcsv_style_free_lines(char **lines)
+{
+	char **p;
+
+	if (!lines)
+		return;
+	for (p = lines; *p; p++)
+		xfree(*p);
+	xfree(lines);
+}
+
+static void
+xcsv_style_free_fields(xcsv_field_def_t *fields, int ct)
+{
+	int i;
+
+	for (i = 0; i < ct; i++) {
+		if (fields[i].key)
+			xfree(fields[i].key);
+		if (fields[i].val)
+			xfree(fields[i].val);
+		if (fields[i].printfc)
+			xfree(fields[i].printfc);
+	}
+	if (fields)
+		xfree(fields);
+}
+
+static void
+xcsv_style_free(xcsv_style_t *style)
+{
+	char **strs[] = {
+		&style->description, &style->extension,
+		&style->field_delimiter, &style->record_delimiter,
+		&style->badchars, &style->encoding, &style->datum
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(strs) / sizeof(strs[0]); i++)
+		if (*strs[i])
+			xfree(*strs[i]);
+	xcsv_style_free_lines(style->prologue);
+	xcsv_style_free_lines(style->epilogue);
+	xcsv_style_free_fields(style->ifield, style->ifield_ct);
+	xcsv_style_free_fields(style->ofield, style->ofield_ct);
+	xfree(style);
+}
+
+/* replace a string member of a style being compiled */
+static void
+xcsv_style_set(char **member, char *val)
+{
+	if (*member)
+		xfree(*member);
+	*member = val;
+}
+
+/* append a line to a NULL terminated prologue or epilogue */
+static void
+xcsv_style_add_line(char ***lines, char *line)
+{
+	int n = 0;
+
+	if (*lines)
+		while ((*lines)[n])
+			n++;
+	*lines = xrealloc(*lines, (n + 2) * sizeof(**lines));
+	(*lines)[n] = line;
+	(*lines)[n + 1] = NULL;
+}
+
+static void
+xcsv_style_add_field(xcsv_field_def_t **fields, int *ct, 
+		char *key, char *val, char *pfc, int options)
+{
+	xcsv_field_def_t *f;
+
+	*fields = xrealloc(*fields, (*ct + 1) * sizeof(**fields));
+	f = &(*fields)[(*ct)++];
+	f->key = key;
+	f->val = val;
+	f->printfc = pfc;
+	f->options = options;
+}
 
 static void
-xcsv_parse_style_line(const char *sbuff)
+xcsv_parse_style_line(xcsv_style_t *style, char *sbuff)
 {
     int i, linecount = 0;
     char *s, *p, *sp;
@@ -213,21 +323,19 @@ xcsv_parse_style_line(const char *sbuff)
 	    sp = csv_stringtrim(&sbuff[16], "\"", 1);
 	    cp = xcsv_get_char_from_constant_table(sp);
 	    if (cp) {
-		xcsv_file.field_delimiter = xstrdup(cp);
+		xcsv_style_set(&style->field_delimiter, xstrdup(cp));
 		xfree(sp);
 	    }
 	    else
-		xcsv_file.field_delimiter = sp;
+		xcsv_style_set(&style->field_delimiter, sp);
 
-		p = csv_stringtrim(xcsv_file.field_delimiter, " ", 0);
+		p = csv_stringtrim(style->field_delimiter, " ", 0);
 
 		/* field delimiters are always bad characters */
 		if (0 == strcmp(p, "\\w")) {
-			char *s = xstrappend(xcsv_file.badchars, " \n\r");
-			if (xcsv_file.badchars) xfree(xcsv_file.badchars);
-			xcsv_file.badchars = s;
+			style->badchars = xstrappend(style->badchars, " \n\r");
 		} else {
-			xcsv_file.badchars = xstrappend(xcsv_file.badchars, p);
+			style->badchars = xstrappend(style->badchars, p);
 		}
 		
 		xfree(p);
@@ -238,24 +346,16 @@ xcsv_parse_style_line(const char *sbuff)
 	    sp = csv_stringtrim(&sbuff[17], "\"", 1);
 	    cp = xcsv_get_char_from_constant_table(sp);
 	    if (cp) {
-		xcsv_file.record_delimiter = xstrdup(cp);
+		xcsv_style_set(&style->record_delimiter, xstrdup(cp));
 		xfree(sp);
 	    }
 	    else
-		xcsv_file.record_delimiter = sp;
+		xcsv_style_set(&style->record_delimiter, sp);
 		
-		p = csv_stringtrim(xcsv_file.record_delimiter, " ", 0);
+		p = csv_stringtrim(style->record_delimiter, " ", 0);
 
 		/* record delimiters are always bad characters */
-		if (xcsv_file.badchars) {
-			xcsv_file.badchars = (char *) xrealloc(xcsv_file.badchars,
-				strlen(xcsv_file.badchars) +
-				strlen(p) + 1);
-		} else {
-			xcsv_file.badchars = (char *) xcalloc(strlen(p) + 1, 1);
-		}
-
-		strcat(xcsv_file.badchars, p);
+		style->badchars = xstrappend(style->badchars, p);
 		
 		xfree(p);
 		
@@ -267,30 +367,30 @@ xcsv_parse_style_line(const char *sbuff)
 			;
 		}
 		if (ISSTOKEN(p, "INTERNAL")) {
-			xcsv_file.type = ff_type_internal;
+			style->type = ff_type_internal;
 		} 
 		/* this is almost inconcievable... */
 		if (ISSTOKEN(p, "SERIAL")) {
-			xcsv_file.type = ff_type_serial;
+			style->type = ff_type_serial;
 		} 
 	} else
 
 	if (ISSTOKEN(sbuff, "DESCRIPTION")) {
-		xcsv_file.description = csv_stringtrim(&sbuff[11],"", 0);
+		xcsv_style_set(&style->description, 
+			csv_stringtrim(&sbuff[11],"", 0));
 	} else
 
 	if (ISSTOKEN(sbuff, "EXTENSION")) {
-		xcsv_file.extension = csv_stringtrim(&sbuff[10],"", 0);
+		xcsv_style_set(&style->extension, 
+			csv_stringtrim(&sbuff[10],"", 0));
 	} else
 
 	if (ISSTOKEN(sbuff, "SHORTLEN")) {
-            if (xcsv_file.mkshort_handle)
-                setshort_length(xcsv_file.mkshort_handle, atoi(&sbuff[9]));
+		style->shortlen = atoi(&sbuff[9]);
 	} else
 
 	if (ISSTOKEN(sbuff, "SHORTWHITE")) {
-            if (xcsv_file.mkshort_handle)
-                setshort_whitespace_ok(xcsv_file.mkshort_handle, atoi(&sbuff[12]));
+		style->shortwhite = atoi(&sbuff[12]);
 	} else
 
 	if (ISSTOKEN(sbuff, "BADCHARS")) {
@@ -304,51 +404,41 @@ xcsv_parse_style_line(const char *sbuff)
 	    else
 		p = sp;
 		
-		if (xcsv_file.badchars) {
-			xcsv_file.badchars = (char *) xrealloc(xcsv_file.badchars,
-				strlen(xcsv_file.badchars) +
-				strlen(p) + 1);
-		} else {
-			xcsv_file.badchars = (char *) xcalloc(strlen(p) + 1, 1);
-		}
-
-		strcat(xcsv_file.badchars, p);
+		style->badchars = xstrappend(style->badchars, p);
 		
 		xfree(p);
 		
 	} else
 
 	if (ISSTOKEN(sbuff, "PROLOGUE")) {
-	    xcsv_prologue_add(xstrdup(&sbuff[9]));
+	    xcsv_style_add_line(&style->prologue, xstrdup(&sbuff[9]));
 	} else
 
 	if (ISSTOKEN(sbuff, "EPILOGUE")) {
-	    xcsv_epilogue_add(xstrdup(&sbuff[9]));
+	    xcsv_style_add_line(&style->epilogue, xstrdup(&sbuff[9]));
 	} else
 
 	if (ISSTOKEN(sbuff, "ENCODING")) {
-	    p = csv_stringtrim(&sbuff[8], "\"", 1);
-	    cet_convert_init(p, 1);
-	    xfree(p);
+	    xcsv_style_set(&style->encoding, 
+		csv_stringtrim(&sbuff[8], "\"", 1));
 	} else
 
 	if (ISSTOKEN(sbuff, "DATUM")) {
 	    p = csv_stringtrim(&sbuff[5], "\"", 1);
-	    xcsv_file.gps_datum = GPS_Lookup_Datum_Index(p);
-	    is_fatal(xcsv_file.gps_datum < 0, MYNAME ": datum \"%s\" is not supported.", p);
-	    xfree(p);
+	    is_fatal(GPS_Lookup_Datum_Index(p) < 0, MYNAME ": datum \"%s\" is not supported.", p);
+	    xcsv_style_set(&style->datum, p);
 	} else
 
 	if (ISSTOKEN(sbuff, "DATATYPE")) {
 	    p = csv_stringtrim(&sbuff[8], "\"", 1);
 	    if (case_ignore_strcmp(p, "TRACK") == 0) {
-		xcsv_file.datatype = trkdata;
+		style->datatype = trkdata;
 	    }
 	    else if (case_ignore_strcmp(p, "ROUTE") == 0) {
-		xcsv_file.datatype = rtedata;
+		style->datatype = rtedata;
 	    }
 	    else if (case_ignore_strcmp(p, "WAYPOINT") == 0) {
-		xcsv_file.datatype = wptdata;
+		style->datatype = wptdata;
 	    }
 	    else {
 		fatal(MYNAME ": Unknown data type \"%s\"!\n", p);
@@ -385,7 +475,8 @@ xcsv_parse_style_line(const char *sbuff)
 		s = csv_lineparse(NULL, ",", "", linecount);
 	    }
 
-	    xcsv_ifield_add(key, val, pfc);
+	    xcsv_style_add_field(&style->ifield, &style->ifield_ct, 
+		key, val, pfc, 0);
 
 	} else
 
@@ -433,90 +524,126 @@ xcsv_parse_style_line(const char *sbuff)
 		s = csv_lineparse(NULL, ",", "", linecount);
 	    }
 
-	    xcsv_ofield_add(key, val, pfc, options);
+	    xcsv_style_add_field(&style->ofield, &style->ofield_ct, 
+		key, val, pfc, options);
 	}
     }
 }
 
+static char *
+xcsv_dup(const char *s)
+{
+	return s ? xstrdup(s) : NULL;
+}
 
 /*
- * A wrapper for xcsv_parse_style_line that reads until it hits
- * a terminating null.   Makes multiple calls to that function so
- * that "ignore to end of line" comments work right.
+ * Load a compiled style into xcsv_file, ready for reading or writing.
  */
 static void
-xcsv_parse_style_buff(const char *sbuff)
+xcsv_use_style(const xcsv_style_t *style)
 {
-	char ibuf[256];
-	char *ibufp;
-	size_t i;
+	char **lp;
+	int i;
 
-	while (*sbuff) {
-		ibuf[0] = 0;
-		i = 0;
-	 	for (ibufp = ibuf; *sbuff != '\n' && i++ < sizeof(ibuf); ) {
-			*ibufp++ = *sbuff++;
-		}
-		while (*sbuff == '\n' || *sbuff == '\r')
-			sbuff++;
-		*ibufp = 0;
-		xcsv_parse_style_line(ibuf);
+	xcsv_file_init();
+
+	xcsv_file.description = xcsv_dup(style->description);
+	xcsv_file.extension = xcsv_dup(style->extension);
+	xcsv_file.field_delimiter = xcsv_dup(style->field_delimiter);
+	xcsv_file.record_delimiter = xcsv_dup(style->record_delimiter);
+	xcsv_file.badchars = xcsv_dup(style->badchars);
+	xcsv_file.type = style->type;
+	xcsv_file.datatype = style->datatype;
+
+	if (style->shortlen >= 0)
+		setshort_length(xcsv_file.mkshort_handle, style->shortlen);
+	if (style->shortwhite >= 0)
+		setshort_whitespace_ok(xcsv_file.mkshort_handle, style->shortwhite);
+	if (style->encoding)
+		cet_convert_init(style->encoding, 1);
+	if (style->datum) {
+		xcsv_file.gps_datum = GPS_Lookup_Datum_Index(style->datum);
+		is_fatal(xcsv_file.gps_datum < 0, MYNAME ": datum \"%s\" is not supported.", style->datum);
+	}
+
+	for (lp = style->prologue; lp && *lp; lp++)
+		xcsv_prologue_add(xstrdup(*lp));
+	for (lp = style->epilogue; lp && *lp; lp++)
+		xcsv_epilogue_add(xstrdup(*lp));
+
+	for (i = 0; i < style->ifield_ct; i++) {
+		const xcsv_field_def_t *f = &style->ifield[i];
+		xcsv_ifield_add(xstrdup(f->key), xcsv_dup(f->val), 
+			xcsv_dup(f->printfc));
+	}
+	for (i = 0; i < style->ofield_ct; i++) {
+		const xcsv_field_def_t *f = &style->ofield[i];
+		xcsv_ofield_add(xstrdup(f->key), xcsv_dup(f->val), 
+			xcsv_dup(f->printfc), f->options);
+	}
+
+	/* if we have no output fields, use input fields as output fields */
+	if (xcsv_file.ofield_ct == 0) {
+		if (xcsv_file.ofield) 
+			xfree(xcsv_file.ofield);
+		xcsv_file.ofield = &xcsv_file.ifield;
+		xcsv_file.ofield_ct = xcsv_file.ifield_ct;
 	}
 }
 
-static void
-xcsv_read_style(const char *fname)
+static const xcsv_style_t *
+xcsv_compile_style(const char *fname)
 {
+    xcsv_style_cache_t *cache;
+    xcsv_style_t *style;
     char *sbuff;
     gbfile *fp;
 
-    xcsv_file_init();
+    for (cache = style_cache; cache; cache = cache->next)
+	if (strcmp(cache->fname, fname) == 0)
+	    return cache->style;
 
+    style = xcsv_style_new();
     fp = gbfopen(fname, "rb", MYNAME);
     while ((sbuff = gbfgetstr(fp))) {
         sbuff = lrtrim(sbuff);
-	xcsv_parse_style_line(sbuff);
-    } while (!gbfeof(fp));
-
-    /* if we have no output fields, use input fields as output fields */
-    if (xcsv_file.ofield_ct == 0) {
-        if (xcsv_file.ofield) 
-            xfree(xcsv_file.ofield);
-        xcsv_file.ofield = &xcsv_file.ifield;
-        xcsv_file.ofield_ct = xcsv_file.ifield_ct;
+	xcsv_parse_style_line(style, sbuff);
     }
     gbfclose(fp);
+
+    cache = xcalloc(sizeof(*cache), 1);
+    cache->fname = xstrdup(fname);
+    cache->style = style;
+    cache->next = style_cache;
+    style_cache = cache;
+    return style;
+}
+
+static void
+xcsv_read_style(const char *fname)
+{
+    xcsv_use_style(xcsv_compile_style(fname));
 }
 
 /*
- * Passed a pointer to an internal buffer that would be identical
- * to the series of bytes that would be in a style file, we set up
- * the xcsv parser and make it ready for general use.
+ * Passed a pointer to a style compiled from the style/ directory by
+ * mkstyle.sh, we set up the xcsv parser and make it ready for
+ * general use.
  */
 void
-xcsv_read_internal_style(const char *style_buf)
+xcsv_read_internal_style(const xcsv_style_t *style)
 {
-	xcsv_file_init();
+	xcsv_use_style(style);
 	xcsv_file.is_internal = 1;
-
-	xcsv_parse_style_buff(style_buf);
-
-	/* if we have no output fields, use input fields as output fields */
-	if (xcsv_file.ofield_ct == 0) {
-		if (xcsv_file.ofield) 
-			xfree(xcsv_file.ofield);
-		xcsv_file.ofield = &xcsv_file.ifield;
-		xcsv_file.ofield_ct = xcsv_file.ifield_ct;
-	}
 }
 
 void
-xcsv_setup_internal_style(const char *style_buf)
+xcsv_setup_internal_style(const xcsv_style_t *style)
 {
 	xcsv_file_init();
 	xcsv_destroy_style();
-	xcsv_file.is_internal = !!style_buf;
-	intstylebuf = style_buf;
+	xcsv_file.is_internal = !!style;
+	intstyle = style;
 }
 
 
@@ -529,7 +656,7 @@ xcsv_rd_init(const char *fname)
      * read it from a user-supplied style file, or die trying.
      */
     if (xcsv_file.is_internal ) {
-	xcsv_read_internal_style( intstylebuf );
+	xcsv_read_internal_style( intstyle );
     }
     else {
         if (!styleopt)
@@ -564,7 +691,7 @@ xcsv_wr_init(const char *fname)
      * read it from a user-supplied style file, or die trying.
      */
     if (xcsv_file.is_internal ) {
-	xcsv_read_internal_style( intstylebuf );
+	xcsv_read_internal_style( intstyle );
     }
     else {
 
@@ -599,6 +726,20 @@ xcsv_wr_init(const char *fname)
     is_fatal(xcsv_file.gps_datum < 0, MYNAME ": datum \"%s\" is not supported.", opt_datum);
 }
 
+static void
+xcsv_exit(void)
+{
+	xcsv_style_cache_t *cache, *next;
+
+	for (cache = style_cache; cache; cache = next) {
+		next = cache->next;
+		xcsv_style_free(cache->style);
+		xfree(cache->fname);
+		xfree(cache);
+	}
+	style_cache = NULL;
+}
+
 static void
 xcsv_wr_position_init(const char *fname)
 {
@@ -627,7 +768,7 @@ xcsv_wr_position(waypoint *wpt)
 	switch(wpt->fix) {
 		case fix_none: 
 			if (wpt->shortname) {
-				xfree(wpt->shortname);
+				strpool_release(wpt->shortname);
 			}
 			wpt->shortname = xstrdup("ESTIMATED Position");
 			break;
@@ -651,13 +792,13 @@ ff_vecs_t xcsv_vecs = {
     xcsv_wr_deinit,
     xcsv_data_read,
     xcsv_data_write,
-    NULL, 
+    xcsv_exit,
     xcsv_args,
     CET_CHARSET_ASCII, 0,	/* CET-REVIEW */
     { NULL, NULL, NULL, xcsv_wr_position_init, xcsv_wr_position, xcsv_wr_position_deinit }
 
 };
 #else
-void xcsv_read_internal_style(const char *style_buf) {}
-void xcsv_setup_internal_style(const char *style_buf) {}
+void xcsv_read_internal_style(const xcsv_style_t *style) {}
+void xcsv_setup_internal_style(const xcsv_style_t *style) {}
 #endif //CSVFMTS_ENABLED
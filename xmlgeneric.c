@@ -28,8 +28,8 @@
 	static XML_Parser psr;
 #endif
 
-static vmem_t current_tag;
 static vmem_t cdatastr;
+static size_t cdatalen;		/* length of the string in cdatastr */
 static gbfile *ifd;
 static xg_tag_mapping *xg_tag_tbl;
 static const char **xg_ignore_taglist;
@@ -167,6 +167,147 @@ xml_tbl_lookup(const char *tag, xg_cb_type cb_type)
 	return NULL;
 }
 
+/*
+ * The tag table is compiled on the fly into a tree of the element paths
+ * seen in the document.  Each path node is reached from its parent by
+ * the element name and holds the three table lookups for its path, so
+ * the table (with its glob patterns) is searched once per distinct path
+ * and not on every element.  The current path is the chain of nodes from
+ * xg_cur_node up to the root.
+ */
+
+typedef struct xg_path_node {
+	struct xg_path_node *parent;
+	struct xg_path_node *next;	/* in the same hash bucket */
+	char *name;			/* element name */
+	char *path;			/* "/parent/path/name" */
+	xg_callback *cb[cb_end];	/* lookup result by cb_type - 1 */
+} xg_path_node;
+
+static xg_path_node *xg_root_node;
+static xg_path_node *xg_cur_node;
+static xg_path_node **xg_node_hash;
+static unsigned int xg_node_hash_size;
+static unsigned int xg_node_count;
+
+static unsigned int
+xml_path_hash(const xg_path_node *parent, const char *name)
+{
+	unsigned int h = (unsigned int)(size_t) parent;
+
+	while (*name)
+		h = (h * 31) + (unsigned char) *name++;
+	return h ^ (h >> 16);
+}
+
+static xg_path_node *
+xml_path_node_new(xg_path_node *parent, const char *name)
+{
+	xg_path_node *node = xcalloc(1, sizeof(*node));
+	int i;
+
+	node->parent = parent;
+	node->name = xstrdup(name);
+	if (parent) {
+		node->path = xmalloc(strlen(parent->path) + strlen(name) + 2);
+		sprintf(node->path, "%s/%s", parent->path, name);
+	}
+	else
+		node->path = xstrdup("");
+	for (i = cb_start; i <= cb_end; i++)
+		node->cb[i - 1] = xml_tbl_lookup(node->path, i);
+
+	return node;
+}
+
+static void
+xml_path_hash_grow(void)
+{
+	unsigned int size = xg_node_hash_size ? xg_node_hash_size * 2 : 256;
+	xg_path_node **hash = xcalloc(size, sizeof(*hash));
+	unsigned int i;
+
+	for (i = 0; i < xg_node_hash_size; i++) {
+		xg_path_node *node, *next;
+
+		for (node = xg_node_hash[i]; node; node = next) {
+			unsigned int h = xml_path_hash(node->parent, node->name) & (size - 1);
+			next = node->next;
+			node->next = hash[h];
+			hash[h] = node;
+		}
+	}
+	if (xg_node_hash) xfree(xg_node_hash);
+	xg_node_hash = hash;
+	xg_node_hash_size = size;
+}
+
+/*
+ * xml_path_child: the node for element 'name' inside 'parent'
+ */
+
+static xg_path_node *
+xml_path_child(xg_path_node *parent, const char *name)
+{
+	unsigned int h = xml_path_hash(parent, name);
+	xg_path_node *node;
+
+	for (node = xg_node_hash[h & (xg_node_hash_size - 1)]; node; node = node->next) {
+		if ((node->parent == parent) && (strcmp(node->name, name) == 0))
+			return node;
+	}
+
+	if (xg_node_count >= xg_node_hash_size) {
+		xml_path_hash_grow();
+	}
+	node = xml_path_node_new(parent, name);
+	h &= (xg_node_hash_size - 1);
+	node->next = xg_node_hash[h];
+	xg_node_hash[h] = node;
+	xg_node_count++;
+
+	return node;
+}
+
+static void
+xml_path_init(void)
+{
+	xg_node_hash = NULL;
+	xg_node_hash_size = xg_node_count = 0;
+	xml_path_hash_grow();
+	xg_root_node = xg_cur_node = xml_path_node_new(NULL, "");
+}
+
+static void
+xml_path_free_node(xg_path_node *node)
+{
+	xfree(node->name);
+	xfree(node->path);
+	xfree(node);
+}
+
+static void
+xml_path_deinit(void)
+{
+	unsigned int i;
+
+	if (xg_root_node == NULL) return;
+
+	for (i = 0; i < xg_node_hash_size; i++) {
+		xg_path_node *node, *next;
+
+		for (node = xg_node_hash[i]; node; node = next) {
+			next = node->next;
+			xml_path_free_node(node);
+		}
+	}
+	xfree(xg_node_hash);
+	xml_path_free_node(xg_root_node);
+	xg_node_hash = NULL;
+	xg_node_hash_size = xg_node_count = 0;
+	xg_root_node = xg_cur_node = NULL;
+}
+
 /*
  * See if tag element 't' is in our list of things to ignore.
  * Returns 0 if it is not on the list.
@@ -192,8 +333,6 @@ xml_consider_ignoring(const char *t)
 static void
 xml_start(void *data, const XML_Char *xml_el, const XML_Char **xml_attr)
 {
-	char *e;
-	char *ep;
 	xg_callback *cb;
 	const char *el;
 	const char **attrs;
@@ -204,16 +343,12 @@ xml_start(void *data, const XML_Char *xml_el, const XML_Char **xml_attr)
 	if (xml_consider_ignoring(el))
 		return;
 
-	vmem_realloc(&current_tag, strlen(current_tag.mem) + 2 + strlen(el));
-
-	e = current_tag.mem;
-        ep = e + strlen(e);
-        *ep++ = '/';
-        strcpy(ep, el);
+	xg_cur_node = xml_path_child(xg_cur_node, el);
 
-	memset(cdatastr.mem, 0, cdatastr.size);
+	*(char *) cdatastr.mem = '\0';
+	cdatalen = 0;
 
-	cb = xml_tbl_lookup(e, cb_start);
+	cb = xg_cur_node->cb[cb_start - 1];
 	if (cb) {
 		(*cb)(NULL, attrs);
 	}
@@ -228,36 +363,43 @@ xml_cdata(void *dta, const XML_Char *xml_s, int len)
 	char *estr;
 	const char *s = xml_convert_to_char_string_n(xml_s, &len);
 
-	vmem_realloc(&cdatastr,  1 + len + strlen(cdatastr.mem));
-	estr = (char *) cdatastr.mem + strlen(cdatastr.mem);
+	/* grow geometrically, text nodes may come in many small pieces */
+	if (cdatalen + len + 1 > cdatastr.size) {
+		vmem_realloc(&cdatastr, 2 * (cdatalen + len + 1));
+	}
+	estr = (char *) cdatastr.mem + cdatalen;
 	memcpy(estr, s, len);
 	estr[len]  = 0;
+	cdatalen += len;
 	xml_free_converted_string(s);
 }
 
 static void
 xml_end(void *data, const XML_Char *xml_el)
 {
-	char *s = strrchr(current_tag.mem, '/');
 	const char *el = xml_convert_to_char_string(xml_el);
 	xg_callback *cb;
 
 	if (xml_consider_ignoring(el))
 		return;
 
-	if (strcmp(s + 1, el)) {
+	if (strcmp(xg_cur_node->name, el)) {
 		fprintf(stderr, "Mismatched tag %s\n", el);
 	}
-	cb = xml_tbl_lookup(current_tag.mem, cb_cdata);
+	cb = xg_cur_node->cb[cb_cdata - 1];
 	if (cb) {
 		(*cb)( (char *) cdatastr.mem, NULL);
 	}
 
-	cb = xml_tbl_lookup(current_tag.mem, cb_end);
+	cb = xg_cur_node->cb[cb_end - 1];
 	if (cb) {
 		(*cb)(el, NULL);
 	}
-	*s = 0;
+	if (xg_cur_node->parent) {
+		xg_cur_node = xg_cur_node->parent;
+	}
+	/* the callbacks may have trimmed cdatastr */
+	cdatalen = strlen(cdatastr.mem);
 	xml_free_converted_string(el);
 }
 
@@ -265,19 +407,19 @@ void xml_read(void)
 {
 	int len;
 	char buf[MY_CBUF];
+	char ubuf[MY_CBUF / 2 * 3];	/* buf converted from UCS-2 */
 	
 	while ((len = gbfread(buf, 1, sizeof(buf), ifd))) {
 		char *str = buf;
 		if (ifd->unicode) {
-			str = cet_str_uni_to_utf8((short *)&buf, len >> 1);
-			len = strlen(str);
+			len = cet_ucs2_to_utf8(ubuf, buf, len >> 1, ifd->big_endian);
+			str = ubuf;
 		}
 		if (!XML_Parse(psr, str, len, gbfeof(ifd))) {
 			fatal(MYNAME ":Parse error at %d: %s\n",
 				(int) XML_GetCurrentLineNumber(psr),
 				XML_ErrorString(XML_GetErrorCode(psr)));
 		}
-		if (str != buf) xfree(str);
 	}
 	XML_ParserFree(psr);
 	
@@ -322,9 +464,6 @@ xml_init0(const char *fname, xg_tag_mapping *tbl, const char *encoding,
 		ifd = NULL;
 	}
 
-	current_tag = vmem_alloc(1,0);
-	*((char *)current_tag.mem) = '\0';
-
 	psr = XML_ParserCreate((const XML_Char *)encoding);
 	if (!psr) {
 		fatal(MYNAME ": Cannot create XML Parser\n");
@@ -332,8 +471,10 @@ xml_init0(const char *fname, xg_tag_mapping *tbl, const char *encoding,
 
 	cdatastr = vmem_alloc(1, 0);
 	*((char *)cdatastr.mem) = '\0';
+	cdatalen = 0;
 
 	xg_tag_tbl = tbl;
+	xml_path_init();
 
 	cet_convert_init(CET_CHARSET_UTF8, 1);
 
@@ -357,7 +498,7 @@ xml_init_offset(const char *fname, xg_tag_mapping *tbl, const char *encoding,
 void
 xml_deinit(void)
 {
-	vmem_free(&current_tag);
+	xml_path_deinit();
 	vmem_free(&cdatastr);
 	if (ifd) {
 		gbfclose(ifd);
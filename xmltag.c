@@ -25,6 +25,82 @@
 
 #include "defs.h"
 
+/*
+ * Trees read from a file take their tags, tag names and attribute
+ * vectors from blocks owned by the fs_xml, and give them back in one go
+ * when it is destroyed.  cdata and attribute values stay separate
+ * allocations, as the character set conversion replaces them.
+ */
+
+typedef struct xml_tag_block {
+	struct xml_tag_block *next;
+	size_t size;		/* bytes of data behind the header */
+	size_t used;
+} xml_tag_block;
+
+#define XML_TAG_ALIGN sizeof(double)
+#define XML_TAG_ROUND(n) (((n) + XML_TAG_ALIGN - 1) & ~(XML_TAG_ALIGN - 1))
+#define XML_TAG_BLOCK_HDR XML_TAG_ROUND(sizeof(xml_tag_block))
+#define XML_TAG_BLOCK_MIN 512
+
+void *
+fs_xml_calloc( fs_xml *xml, size_t count, size_t size )
+{
+	xml_tag_block *block = xml->arena;
+	void *res;
+
+	size = XML_TAG_ROUND(count * size);
+	if ( !block || (block->used + size > block->size) ) {
+		size_t bsize = block ? 2 * block->size : XML_TAG_BLOCK_MIN;
+
+		while ( bsize < size ) bsize *= 2;
+		block = xmalloc( XML_TAG_BLOCK_HDR + bsize );
+		block->size = bsize;
+		block->used = 0;
+		block->next = xml->arena;
+		xml->arena = block;
+	}
+	res = (char *)block + XML_TAG_BLOCK_HDR + block->used;
+	block->used += size;
+	memset( res, 0, size );
+	return res;
+}
+
+xml_tag *
+fs_xml_tag_alloc( fs_xml *xml )
+{
+	return (xml_tag *)fs_xml_calloc( xml, 1, sizeof(xml_tag) );
+}
+
+char *
+fs_xml_strdup( fs_xml *xml, const char *s )
+{
+	size_t len = strlen( s ) + 1;
+
+	return memcpy( fs_xml_calloc( xml, 1, len ), s, len );
+}
+
+/* frees what a tree taken from the arena holds outside of it */
+static void
+free_xml_tag_data( xml_tag *tag )
+{
+	char **ap;
+
+	for ( ; tag; tag = tag->sibling ) {
+		if (tag->cdata) {
+			xfree(tag->cdata);
+		}
+		if (tag->parentcdata) {
+			xfree(tag->parentcdata);
+		}
+		if (tag->attributes) {
+			for (ap = tag->attributes; *ap; ap++)
+				xfree(*ap);
+		}
+		free_xml_tag_data(tag->child);
+	}
+}
+
 static void
 free_xml_tag( xml_tag *tag )
 {
@@ -122,7 +198,16 @@ fs_xml *fs_xml_alloc( long type );
 static void
 fs_xml_destroy( void *fs ) {
 	fs_xml *xml = (fs_xml *)fs;
-	if ( xml ) {
+	if ( xml && xml->arena ) {
+		xml_tag_block *block, *next;
+
+		free_xml_tag_data( xml->tag );
+		for ( block = xml->arena; block; block = next ) {
+			next = block->next;
+			xfree( block );
+		}
+	}
+	else if ( xml ) {
 		free_xml_tag( xml->tag );
 	}
 	xfree( fs );
@@ -137,6 +222,7 @@ fs_xml_copy( void **copy, void *source ) {
 	}
 	*copy = (void *)fs_xml_alloc( src->fs.type );
 	memcpy( *copy, source, sizeof(fs_xml) );
+	((fs_xml *)(*copy))->arena = NULL;	/* the copy is made of single allocations */
 	copy_xml_tag( &(((fs_xml *)(*copy))->tag), src->tag, NULL );
 }
 